@@ -0,0 +1,123 @@
+#include "stdio.h"
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "hardware/clocks.h"
+
+#include "lmx2592.h"
+#include "board.h"
+
+/*
+    Hop-throughput benchmark firmware. Runs a fixed suite on boot (once USB is up), then again on every key press.
+    Output is one CSV line per benchmark, between BENCH_BEGIN and BENCH_END lines:
+
+    BENCH,<name>,<ops>,<total us>,<us per op>,<ops per s>,<bus utilisation %>
+    BENCH_FCAL,<FCALs since boot>,<retunes that skipped the FCAL>
+
+    Names and column order stay fixed so results from different firmware candidates can be diffed directly.
+*/
+
+LMX2592 pll(BOARD_LMX_PINS);
+
+const int RETUNE_HOPS = 50;
+const int SIMPLE_OPS = 500;
+const int READBACK_OPS = 10;
+
+struct bench_run {
+    uint64_t start_us;
+    uint32_t start_frames;
+};
+
+bench_run bench_start() {
+    return {time_us_64(), pll.bus_frames};
+}
+
+void bench_report(const char* name, const bench_run& run, int ops) {
+    uint64_t total_us = time_us_64() - run.start_us;
+    uint32_t frames = pll.bus_frames - run.start_frames;
+    // time the bus spends actually clocking bits, against the wall clock
+    double bus_us = frames * 24.0 * 1e6 / pll.get_spi_baud();
+    printf("BENCH,%s,%d,%llu,%.2f,%.1f,%.1f\n", name, ops, (unsigned long long) total_us,
+        (double) total_us / ops, ops * 1e6 / (double) total_us, 100.0 * bus_us / (double) total_us);
+}
+
+// full retunes hopping between the two ends of a band, each one waiting for lock
+void bench_retunes(const char* name, double lo_hz, double hi_hz) {
+    pll.set_frequency(lo_hz);
+    pll.wait_for_lock(10000);
+    bench_run run = bench_start();
+    int failures = 0;
+    for (int k = 0; k < RETUNE_HOPS; k++) {
+        pll.set_frequency((k & 1) ? lo_hz : hi_hz);
+        if (pll.wait_for_lock(10000) < 0) failures++;
+    }
+    bench_report(name, run, RETUNE_HOPS);
+    if (failures)
+        printf("BENCH_WARN,%s,%d hops failed to lock\n", name, failures);
+}
+
+void run_suite() {
+    printf("BENCH_BEGIN,%s,%d,%d\n", BUILD_PROFILE, (int) (clock_get_hz(clk_sys) / 1000), (int) pll.get_spi_baud());
+
+    // every channel divider band, 10% in from each edge
+    char name[32];
+    for (int band = 0; band < LMX2592::CHDIV_BANDS; band++) {
+        double lo = 1e6 * LMX2592::chdiv_table[band][0];
+        double hi = 1e6 * LMX2592::chdiv_table[band][1];
+        snprintf(name, sizeof(name), "retune_chdiv%d", LMX2592::chdiv_table[band][6]);
+        bench_retunes(name, lo + 0.1 * (hi - lo), hi - 0.1 * (hi - lo));
+    }
+    bench_retunes("retune_fundamental", 3'900'000'000.0, 6'700'000'000.0);
+    bench_retunes("retune_doubler", 7'400'000'000.0, 9'500'000'000.0);
+    // the VCO stays at 4 GHz, only the channel divider or the doubler changes, so no FCAL
+    bench_retunes("retune_same_vco_chdiv", 1'000'000'000.0, 2'000'000'000.0);
+    bench_retunes("retune_same_vco_doubler", 4'000'000'000.0, 8'000'000'000.0);
+
+    bench_run run = bench_start();
+    for (int k = 0; k < SIMPLE_OPS; k++)
+        pll.set_power_int(k & 1 ? 10 : 20);
+    bench_report("power_change", run, SIMPLE_OPS);
+
+    run = bench_start();
+    for (int k = 0; k < SIMPLE_OPS; k++)
+        pll.enable_rf1(k & 1);
+    bench_report("output_toggle", run, SIMPLE_OPS);
+    pll.enable_rf1(0);
+
+    uint16_t contents[71];
+    run = bench_start();
+    for (int k = 0; k < READBACK_OPS; k++)
+        pll.read_all_values(contents, 0);
+    bench_report("readback_dump", run, READBACK_OPS);
+
+    // polling an already locked PLL, i.e. the fixed cost of a lock wait
+    run = bench_start();
+    for (int k = 0; k < SIMPLE_OPS; k++)
+        pll.wait_for_lock(10000);
+    bench_report("lock_wait", run, SIMPLE_OPS);
+
+    printf("BENCH_FCAL,%u,%u\n", (unsigned) pll.fcal_count, (unsigned) pll.fcal_skipped);
+    printf("BENCH_END\n");
+}
+
+int main() {
+    board_init_clocks();
+    stdio_init_all();
+
+    // give the host a chance to open the port before the results go out
+    uint64_t deadline = time_us_64() + 10'000'000;
+    while (!stdio_usb_connected() && time_us_64() < deadline)
+        sleep_ms(10);
+
+    pll.init_spi();
+    lmx2592_link_result results[LMX2592::MAX_LINK_RATES];
+    int num_results;
+    pll.train_spi(results, &num_results);
+    pll.set_power_int(0);
+    pll.enable_rf1(0);
+    pll.enable_rf2(0);
+
+    while (1) {
+        run_suite();
+        getchar(); // any key runs it again
+    }
+}
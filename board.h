@@ -0,0 +1,42 @@
+#pragma once
+#include "lmx2592.h"
+#include "hardware/clocks.h"
+#include "hardware/vreg.h"
+
+// pinout of the LMX2592 test board
+
+#define GPIO_RGB_B      25
+#define GPIO_RGB_G      16
+#define GPIO_RGB_R      17
+
+#define GPIO_SPI_MOSI   3
+#define GPIO_SPI_SCK    2
+#define GPIO_SPI_LMX_CS 1
+#define GPIO_LMX_MUXOUT 4
+#define GPIO_LMX_EN     0
+
+#define GPIO_LMX_SYSREFFREQ 28
+#define GPIO_LMX_RAMPCLK    29
+#define GPIO_LMX_RAMPDIR    6
+#define GPIO_LMX_SYNC       7
+
+#define BOARD_LMX_PINS {spi0, GPIO_SPI_SCK, GPIO_SPI_MOSI, GPIO_LMX_MUXOUT, GPIO_SPI_LMX_CS, GPIO_LMX_EN}
+
+#if LMX_PERFORMANCE_BUILD
+#define SYS_CLOCK_KHZ   250000 // needs the flash divider from CMakeLists.txt to stay inside the flash spec
+#define BUILD_PROFILE   "performance"
+#else
+#define BUILD_PROFILE   "default"
+#endif
+
+// call first thing in main(), before stdio comes up
+static inline void board_init_clocks() {
+#if LMX_PERFORMANCE_BUILD
+    // bump the core voltage before the overclock, and run clk_peri (which the SPI bit clock divides down from)
+    // straight off the system PLL so the faster SPI rates become reachable
+    vreg_set_voltage(VREG_VOLTAGE_1_15);
+    sleep_ms(2);
+    set_sys_clock_khz(SYS_CLOCK_KHZ, true);
+    clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS, SYS_CLOCK_KHZ * 1000, SYS_CLOCK_KHZ * 1000);
+#endif
+}
@@ -0,0 +1,70 @@
+#include "event_log.h"
+#include "hardware/sync.h"
+#include "pico/stdio_usb.h"
+#include "tusb.h"
+#include "stdio.h"
+
+volatile log_level log_verbosity = LOG_INFO;
+volatile uint32_t log_dropped = 0;
+
+static log_record log_buf[LOG_SIZE];
+static volatile uint32_t log_head = 0; // written by the producers
+static volatile uint32_t log_tail = 0; // written by log_flush() only
+
+static const char* const LOG_FORMATS[NUM_LOG_EVENTS] = {
+    "> Frequency set to %d.%06d MHz\n",
+    "> Error: frequency out of bounds\n",
+    "> Device %d: PLL locked successfully after %d us\n",
+    "> Device %d: PLL could not lock. Maybe there is a problem\n",
+    "> Device %d: lock lost\n",
+    "> Device %d: lock back after %d us\n",
+    "> Device %d: recalibrating after unlock\n",
+    "> Step %d.%06d MHz locked after %d us\n",
+    "> Device %d: awake and locked after %d us (full calibration needed: %d)\n",
+    "> Device %d: PLL could not lock after wake. Maybe there is a problem\n",
+    "> Device %d: SPI link at %d Hz, %d errors\n",
+    "> Device %d: SPI link trained to %d Hz\n",
+};
+
+void log_event(log_level level, log_event_id id, int32_t a0, int32_t a1, int32_t a2) {
+    if (level > log_verbosity) return;
+    uint32_t time_us = time_us_32();
+    // producers can be IRQs, so the slot is claimed and filled with interrupts off. it's only a handful of stores
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t head = log_head;
+    if (head - log_tail >= LOG_SIZE) {
+        log_dropped = log_dropped + 1;
+        restore_interrupts(irq);
+        return;
+    }
+    log_record& rec = log_buf[head & (LOG_SIZE - 1)];
+    rec.time_us = time_us;
+    rec.id = id;
+    rec.level = level;
+    rec.args[0] = a0;
+    rec.args[1] = a1;
+    rec.args[2] = a2;
+    log_head = head + 1;
+    restore_interrupts(irq);
+}
+
+int log_flush(int max_records) {
+    // nobody listening: keep the records, if they overflow they get counted
+    if (!stdio_usb_connected()) return 0;
+
+    int sent = 0;
+    while (sent < max_records && log_tail != log_head) {
+        // don't let printf block on a full CDC buffer, come back on a later idle pass instead
+        if (tud_cdc_write_available() < 96) break;
+        const log_record& rec = log_buf[log_tail & (LOG_SIZE - 1)];
+        if (rec.id < NUM_LOG_EVENTS)
+            printf(LOG_FORMATS[rec.id], (int) rec.args[0], (int) rec.args[1], (int) rec.args[2]);
+        log_tail = log_tail + 1;
+        sent++;
+    }
+    return sent;
+}
+
+uint32_t log_pending() {
+    return log_head - log_tail;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// deferred logging: hot paths only drop a small binary record into a ring, the formatting and the USB traffic
+// happen later from log_flush() on the idle path. a full ring drops the record (and counts it), it never blocks
+
+enum log_level {
+    LOG_ERROR,
+    LOG_WARN,
+    LOG_INFO,
+    LOG_DEBUG,
+};
+
+// every event has a fixed format string in event_log.cpp, the arguments fill it in
+enum log_event_id : uint8_t {
+    EV_FREQ_SET,      // MHz, Hz remainder
+    EV_FREQ_BOUNDS,   //
+    EV_LOCKED,        // device, us
+    EV_LOCK_TIMEOUT,  // device
+    EV_UNLOCK,        // device
+    EV_RELOCK,        // device, recovery us
+    EV_AUTO_RELOCK,   // device
+    EV_SWEEP_STEP,    // MHz, Hz remainder, lock us
+    EV_WAKE,          // device, us, needed a full calibration
+    EV_WAKE_TIMEOUT,  // device
+    EV_LINK_RATE,     // device, Hz, errors
+    EV_LINK_TRAINED,  // device, Hz
+    NUM_LOG_EVENTS
+};
+
+struct log_record {
+    uint32_t time_us;
+    log_event_id id;
+    uint8_t level;
+    int32_t args[3];
+};
+
+static constexpr uint32_t LOG_SIZE = 256; // power of two
+
+extern volatile log_level log_verbosity;
+extern volatile uint32_t log_dropped;
+
+void log_event(log_level level, log_event_id id, int32_t a0 = 0, int32_t a1 = 0, int32_t a2 = 0);
+// formats and sends up to max_records queued records, as long as the host is taking them. returns how many went
+int log_flush(int max_records);
+uint32_t log_pending();
@@ -1,37 +1,104 @@
 #include "lmx2592.h"
 #include "hardware/spi.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "spi_trace.h"
+#include "event_log.h"
 #include "stdio.h"
 
 
 
-#define GPIO_SPI_MOSI   3
-#define GPIO_SPI_SCK    2
-#define GPIO_SPI_LMX_CS 1
-#define SPI_PORT        spi0
+LMX2592::LMX2592(const lmx2592_pins& pins) : pins(pins) {
+    load_defaults_into_config();
+}
 
-#define GPIO_LMX_SYSREFFREQ 28
-#define GPIO_LMX_RAMPCLK    29
-#define GPIO_LMX_MUXOUT     4
-#define GPIO_LMX_RAMPDIR    6
-#define GPIO_LMX_SYNC       7
-#define GPIO_LMX_EN         0
+uint32_t LMX2592::bus_baud[2] = {0, 0};
+void (*LMX2592::lock_wait_gap)() = nullptr;
 
+void LMX_HOT(LMX2592::select_baud)() {
+    // devices sharing a bus may have trained to different rates
+    uint idx = spi_get_index(pins.spi);
+    if (bus_baud[idx] != spi_baud) {
+        spi_set_baudrate(pins.spi, spi_baud);
+        bus_baud[idx] = spi_baud;
+    }
+}
 
-void LMX2592::spi_write24(uint8_t address, uint16_t data) {
+void LMX_HOT(LMX2592::spi_write24)(uint8_t address, uint16_t data) {
+    select_baud();
     
     uint8_t arr[] = {
-        address & 0x7F,
+        (uint8_t) (address & 0x7F),
         (uint8_t) (data >> 8),
         (uint8_t) (data & 0xFF)
     };
-    //printf("writing: addr = %d, data = 0x%x\n", address, data);
-    sleep_us(10);
-    gpio_put(GPIO_SPI_LMX_CS, 0);
-    sleep_us(10);
-    spi_write_blocking(SPI_PORT, arr, 3);
-    sleep_us(10);
-    gpio_put(GPIO_SPI_LMX_CS, 1);
-    sleep_us(10);
+    spi_trace_record(pins.cs, address & 0x7F, data);
+    bus_frames++;
+    // busy waits rather than sleeps, these frames can go out from IRQ context
+    busy_wait_us_32(10);
+    gpio_put(pins.cs, 0);
+    busy_wait_us_32(10);
+    spi_write_blocking(pins.spi, arr, 3);
+    busy_wait_us_32(10);
+    gpio_put(pins.cs, 1);
+    busy_wait_us_32(10);
+}
+
+void LMX_HOT(LMX2592::broadcast_write24)(LMX2592* const* devs, int count, uint8_t address, uint16_t data) {
+    uint8_t arr[] = {
+        (uint8_t) (address & 0x7F),
+        (uint8_t) (data >> 8),
+        (uint8_t) (data & 0xFF)
+    };
+    // one frame per bus, with every CS on that bus asserted at once
+    for (int i = 0; i < count; i++) {
+        bool bus_done = false;
+        for (int j = 0; j < i; j++) {
+            if (devs[j]->pins.spi == devs[i]->pins.spi) bus_done = true;
+        }
+        if (bus_done) continue;
+
+        // as fast as the slowest device on the bus trained to
+        uint32_t baud = devs[i]->spi_baud;
+        for (int j = i + 1; j < count; j++) {
+            if (devs[j]->pins.spi == devs[i]->pins.spi && devs[j]->spi_baud < baud) baud = devs[j]->spi_baud;
+        }
+        uint idx = spi_get_index(devs[i]->pins.spi);
+        if (bus_baud[idx] != baud) {
+            spi_set_baudrate(devs[i]->pins.spi, baud);
+            bus_baud[idx] = baud;
+        }
+        busy_wait_us_32(10);
+        for (int j = i; j < count; j++) {
+            if (devs[j]->pins.spi == devs[i]->pins.spi) {
+                spi_trace_record(devs[j]->pins.cs, address & 0x7F, data);
+                devs[j]->bus_frames++;
+                gpio_put(devs[j]->pins.cs, 0);
+            }
+        }
+        busy_wait_us_32(10);
+        spi_write_blocking(devs[i]->pins.spi, arr, 3);
+        busy_wait_us_32(10);
+        for (int j = i; j < count; j++) {
+            if (devs[j]->pins.spi == devs[i]->pins.spi) gpio_put(devs[j]->pins.cs, 1);
+        }
+        busy_wait_us_32(10);
+    }
+}
+
+uint16_t LMX_HOT(LMX2592::spi_read24)(uint8_t address) {
+    // the device must be in readback mode (MUXOUT_SEL = 0) for this to return anything
+    select_baud();
+    uint8_t cmd = address | (1 << 7); // READ mode
+    uint8_t read_contents[2];
+    gpio_put(pins.cs, 0);
+    spi_write_blocking(pins.spi, &cmd, 1);
+    spi_read_blocking(pins.spi, 0, read_contents, 2);
+    gpio_put(pins.cs, 1);
+    uint16_t data = (uint16_t)read_contents[1] | ((uint16_t)read_contents[0] << 8);
+    spi_trace_record(pins.cs, cmd, data);
+    bus_frames++;
+    return data;
 }
 
 void LMX2592::soft_reset() {
@@ -43,27 +110,101 @@ void LMX2592::soft_reset() {
     load_values_into_regfile();
     spi_write24(0, regfile[0]);
 }
-void LMX2592::do_fcal() {
+void LMX_HOT(LMX2592::do_fcal)() {
     config_fields.FCAL_EN_1b = 1;
     load_values_into_regfile();
+    fcal_time_us = time_us_32();
     spi_write24(0, regfile[0]);
+    fcal_count++;
+    fcal_valid = false; // until wait_for_lock() sees it lock
 }
 
+// bits that can change without the VCO having to be calibrated again, as long as nothing else does: the output
+// path (channel divider, distribution, muxes, doubler and its feedback prescaler), output power and the charge
+// pump. in R0, the FCAL trigger and the MUXOUT select
+constexpr uint16_t LMX2592::fcal_free_bits(uint8_t address) {
+    switch (address) {
+        case 0: return 0x000c;
+        case 14: return 0xffff;
+        case 30: return 0x0001; // VCO_2X_EN
+        case 31: return 0xffff;
+        case 34: return 0x0020; // CHDIV_EN
+        case 35: return 0xffff;
+        case 36: return 0xffff;
+        case 37: return 0x1000; // PLL_N_PRE
+        case 46: return 0x3fc0;
+        case 47: return 0xffff;
+        case 48: return 0x0003; // OUTB_MUX
+        default: return 0;
+    }
+}
 
-void LMX2592::init_spi() {
-    spi_init(SPI_PORT, 500000);
-    //spi_set_format(SPI_PORT, 8, SPI_CPOL_1, SPI_CPHA_1, SPI_MSB_FIRST);
-    gpio_set_function(GPIO_SPI_MOSI, GPIO_FUNC_SPI);
-    gpio_set_function(GPIO_SPI_SCK, GPIO_FUNC_SPI);
-    gpio_set_function(GPIO_LMX_MUXOUT, GPIO_FUNC_SPI);
+bool LMX2592::needs_fcal() {
+    if (!fcal_valid) return true;
+    for (int a = 0; a < 71; a++) {
+        if ((regfile[a] ^ previous_regfile[a]) & ~fcal_free_bits(a)) return true;
+    }
+    return false;
+}
 
-    gpio_init(GPIO_SPI_LMX_CS);
-    gpio_set_dir(GPIO_SPI_LMX_CS, GPIO_OUT);
-    gpio_put(GPIO_SPI_LMX_CS, 1);
+void LMX_HOT(LMX2592::retune_without_fcal)() {
+    if (fastlock) {
+        // nothing to acquire, the charge pump stays at its steady currents
+        config_fields.CP_ICOARSE_2b = steady_icoarse;
+        config_fields.CP_IUP_5b = steady_iup;
+        config_fields.CP_IDN_5b = steady_idn;
+        load_values_into_regfile();
+    }
+    // R0 only differs in FCAL_EN, which must stay off
+    for (int a = 70; a > 0; a--) {
+        if (regfile[a] != previous_regfile[a])
+            spi_write24(a, regfile[a]);
+    }
+    fcal_skipped++;
+}
 
-    gpio_init(GPIO_LMX_EN);
-    gpio_set_dir(GPIO_LMX_EN, GPIO_OUT);
-    gpio_put(GPIO_LMX_EN, 1);
+void LMX2592::readback_mode(bool enabled) {
+    config_fields.FCAL_EN_1b = 0;
+    if (enabled) {
+        // MUXOUT stops being lock detect while we read, so the monitor has to look away
+        monitor_paused = true;
+        config_fields.MUXOUT_SEL_1b = 0;
+        load_values_into_regfile();
+        spi_write24(0, regfile[0]);
+    }
+    else {
+        config_fields.MUXOUT_SEL_1b = 1;
+        load_values_into_regfile();
+        spi_write24(0, regfile[0]);
+        busy_wait_us_32(10);
+        last_lock_level = gpio_get(pins.muxout);
+        monitor_paused = false;
+    }
+}
+
+
+void LMX2592::init_pins() {
+    if (pins_ready) return;
+    pins_ready = true;
+    // CS goes high before anything else so that devices sharing this bus ignore the traffic
+    gpio_init(pins.cs);
+    gpio_set_dir(pins.cs, GPIO_OUT);
+    gpio_put(pins.cs, 1);
+
+    gpio_init(pins.en);
+    gpio_set_dir(pins.en, GPIO_OUT);
+    gpio_put(pins.en, 1);
+}
+
+void LMX2592::init_spi() {
+    init_pins();
+    spi_init(pins.spi, spi_baud);
+    bus_baud[spi_get_index(pins.spi)] = spi_baud;
+    // the LMX2592 latches SDI on the rising edge of SCK and idles it low
+    spi_set_format(pins.spi, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    gpio_set_function(pins.mosi, GPIO_FUNC_SPI);
+    gpio_set_function(pins.sck, GPIO_FUNC_SPI);
+    gpio_set_function(pins.muxout, GPIO_FUNC_SPI);
 
     sleep_ms(10);
 
@@ -75,35 +216,285 @@ void LMX2592::init_spi() {
     do_fcal();
 }
 
+void LMX2592::init_all(LMX2592* const* devs, int count) {
+    for (int i = 0; i < count; i++) {
+        devs[i]->device_index = i;
+        devs[i]->init_pins();
+    }
+    for (int i = 0; i < count; i++) {
+        devs[i]->init_spi();
+    }
+}
+
+void LMX_HOT(LMX2592::broadcast_write_all)(LMX2592* const* devs, int count) {
+    for (int i = 0; i < count; i++) {
+        devs[i]->load_values_into_regfile();
+    }
+    for (int reg = 70; reg >= 0; reg--) {
+        if (!devs[0]->write_detect[reg]) continue;
+        bool identical = true;
+        for (int i = 1; i < count; i++) {
+            if (devs[i]->regfile[reg] != devs[0]->regfile[reg]) identical = false;
+        }
+        if (identical) {
+            broadcast_write24(devs, count, reg, devs[0]->regfile[reg]);
+        }
+        else {
+            for (int i = 0; i < count; i++) {
+                devs[i]->spi_write24(reg, devs[i]->regfile[reg]);
+            }
+        }
+    }
+}
+
+void LMX_HOT(LMX2592::broadcast_fcal)(LMX2592* const* devs, int count) {
+    for (int i = 0; i < count; i++) {
+        devs[i]->config_fields.FCAL_EN_1b = 1;
+        devs[i]->load_values_into_regfile();
+        devs[i]->fcal_time_us = time_us_32();
+        devs[i]->fcal_count++;
+        devs[i]->fcal_valid = false;
+    }
+    bool identical = true;
+    for (int i = 1; i < count; i++) {
+        if (devs[i]->regfile[0] != devs[0]->regfile[0]) identical = false;
+    }
+    if (identical) {
+        broadcast_write24(devs, count, 0, devs[0]->regfile[0]);
+    }
+    else {
+        for (int i = 0; i < count; i++) {
+            devs[i]->spi_write24(0, devs[i]->regfile[0]);
+        }
+    }
+}
+
+bool LMX2592::broadcast_frequency(LMX2592* const* devs, int count, double freq_hz) {
+    bool calibrate = false;
+    for (int i = 0; i < count; i++) {
+        if (!devs[i]->plan_frequency(freq_hz)) return false;
+        if (devs[i]->needs_fcal()) calibrate = true;
+    }
+    if (!calibrate) {
+        for (int i = 0; i < count; i++)
+            devs[i]->retune_without_fcal();
+        return true;
+    }
+    // one FCAL frame for everyone, even the devices that could have done without
+    broadcast_write_all(devs, count);
+    broadcast_fcal(devs, count);
+    for (int i = 0; i < count; i++) {
+        if (devs[i]->fastlock) devs[i]->finish_fastlock();
+    }
+    return true;
+}
+
+bool LMX2592::plan_image(double freq_hz, uint16_t* image) {
+    lmx2592_fields saved_fields = config_fields;
+    double saved_vco_hz = planned_vco_hz;
+    bool ok = plan_frequency(freq_hz);
+    if (ok) {
+        for (int i = 0; i < 71; i++) image[i] = regfile[i];
+    }
+    config_fields = saved_fields;
+    planned_vco_hz = saved_vco_hz;
+    load_values_into_regfile();
+    return ok;
+}
+
+double LMX2592::vco_from_config() {
+    // the feedback is always prescaler (2, or 4 from the doubled output) x N, so fVCO = 2 x fPFD x N either way
+    double pfd_freq = REF_HZ * (config_fields.OSC_2X_1b ? 2 : 1) * config_fields.MULT_5b / config_fields.PLL_R_8b;
+    uint32_t num = ((uint32_t) config_fields.PLL_NUM_31_16__16b << 16) | config_fields.PLL_NUM_15_0__16b;
+    uint32_t den = ((uint32_t) config_fields.PLL_DEN_31_16__16b << 16) | config_fields.PLL_DEN_15_0__16b;
+    return 2 * pfd_freq * (config_fields.PLL_N_12b + (den ? (double) num / den : 0.0));
+}
+
+double LMX2592::output_from_config() {
+    double vco_freq = vco_from_config();
+    if (config_fields.OUTA_MUX_2b == 1)
+        return config_fields.VCO_2X_EN_1b ? 2 * vco_freq : vco_freq;
+    for (int row = 0; row < CHDIV_BANDS; row++) {
+        if (config_fields.CHDIV_SEG1_1b == chdiv_table[row][2] && config_fields.CHDIV_SEG2_4b == chdiv_table[row][3] &&
+            config_fields.CHDIV_SEG3_3b == chdiv_table[row][4] && config_fields.CHDIV_SEG_SEL_4b == chdiv_table[row][5])
+            return vco_freq / chdiv_table[row][6];
+    }
+    return 0;
+}
+
+bool LMX_HOT(LMX2592::write_registers)(const uint8_t* addresses, const uint16_t* values, int count) {
+    // only what actually changes goes out, highest address first like write_all_values()
+    bool recalibrate = false;
+    for (int k = 0; k < count; k++) {
+        uint8_t address = addresses[k];
+        uint16_t changed = regfile[address] ^ values[k];
+        if (changed == 0) continue;
+        if (changed & ~fcal_free_bits(address)) recalibrate = true;
+        regfile[address] = values[k];
+        // FCAL_EN on its own doesn't need to go out, do_fcal() sets it when it's wanted
+        if (address == 0 && changed == 0x0008) continue;
+        spi_write24(address, values[k]);
+    }
+    load_regfile_into_config();
+    return recalibrate;
+}
+
+void LMX_HOT(LMX2592::apply_registers)(const uint8_t* addresses, const uint16_t* values, int count) {
+    if (start_registers(addresses, values, count) && fastlock) finish_fastlock();
+}
+
+void LMX_HOT(LMX2592::apply_registers_irq)(const uint8_t* addresses, const uint16_t* values, int count) {
+    if (start_registers(addresses, values, count)) retune_pending = true;
+}
+
+bool LMX_HOT(LMX2592::start_registers)(const uint8_t* addresses, const uint16_t* values, int count) {
+    bool recalibrate = write_registers(addresses, values, count);
+    planned_vco_hz = vco_from_config();
+    if (!recalibrate && fcal_valid) {
+        fcal_skipped++;
+        return false;
+    }
+
+    if (fastlock) {
+        config_fields.CP_ICOARSE_2b = FASTLOCK_ICOARSE;
+        config_fields.CP_IUP_5b = FASTLOCK_IUPDN;
+        config_fields.CP_IDN_5b = FASTLOCK_IUPDN;
+        config_fields.FCAL_EN_1b = 0;
+        load_values_into_regfile();
+        spi_write24(14, regfile[14]);
+    }
+    do_fcal();
+    return true;
+}
+
+int LMX2592::service_retune() {
+    // apply_registers_irq() only got as far as the FCAL, the waiting is done here
+    if (!retune_pending) return FASTLOCK_NONE;
+    retune_pending = false;
+    if (!fastlock) return wait_for_lock(FASTLOCK_TIMEOUT_US);
+    finish_fastlock();
+    int lock_time = fastlock_result;
+    fastlock_result = FASTLOCK_NONE; // nobody is going to collect it
+    return lock_time;
+}
+
 void LMX2592::load_divider_into_config(double divider) {
-    uint16_t N_divider = (int)divider;
+    divider_fields(config_fields, divider);
+}
 
-    double frac = divider - (double) N_divider;
-    double denom_f = (double) 0xffffffff; // maximum possible divider
-    double numer_f = frac * denom_f;
+int LMX_HOT(LMX2592::wait_for_lock)(uint32_t timeout_us) {
+    if (fastlock_result != FASTLOCK_NONE) {
+        // the retune already waited for this lock, hand over what it measured
+        int lock_time = fastlock_result;
+        fastlock_result = FASTLOCK_NONE;
+        return lock_time;
+    }
+    uint64_t start_time = time_us_64();
+    while (!is_locked()) {
+        uint64_t delta_time = time_us_64() - start_time;
+        if (delta_time > timeout_us) {
+            fcal_valid = false;
+            return -1;
+        }
+        if (lock_wait_gap) lock_wait_gap();
+    }
+    int lock_time = (int) (time_us_64() - start_time);
+    fcal_valid = true; // only a calibration that locked is worth keeping
+    if (cal_profile == CAL_SEEDED)
+        learn_vco_core();
+    return lock_time;
+}
 
-    config_fields.PLL_N_12b = N_divider;
+void LMX2592::set_fastlock(bool enabled) {
+    // a scheduled retune still running with the boost finishes the way it started
+    service_retune();
+    if (enabled && !fastlock) {
+        // whatever the charge pump is set to now is what we settle back to
+        steady_icoarse = config_fields.CP_ICOARSE_2b;
+        steady_iup = config_fields.CP_IUP_5b;
+        steady_idn = config_fields.CP_IDN_5b;
+    }
+    fastlock = enabled;
+    fastlock_result = FASTLOCK_NONE;
+}
 
-    config_fields.PLL_DEN_15_0__16b = (uint16_t)(((uint32_t) denom_f) & 0xffff);
-    config_fields.PLL_DEN_31_16__16b = (uint16_t)(((uint32_t) denom_f >> 16) & 0xffff);
-    
-    config_fields.PLL_NUM_15_0__16b = (uint16_t)(((uint32_t) numer_f) & 0xffff);
-    config_fields.PLL_NUM_31_16__16b = (uint16_t)(((uint32_t) numer_f >> 16) & 0xffff);
+void LMX_HOT(LMX2592::finish_fastlock)() {
+    fastlock_result = FASTLOCK_NONE;
+    int lock_time = wait_for_lock(FASTLOCK_TIMEOUT_US);
+
+    // walk the currents back down in a few steps rather than one jump, so the loop isn't kicked out of lock
+    uint16_t boost = config_fields.CP_IUP_5b;
+    for (int step = 1; step <= FASTLOCK_STEPS; step++) {
+        config_fields.CP_IUP_5b = boost + (steady_iup - boost) * step / FASTLOCK_STEPS;
+        config_fields.CP_IDN_5b = boost + (steady_idn - boost) * step / FASTLOCK_STEPS;
+        if (step == FASTLOCK_STEPS)
+            config_fields.CP_ICOARSE_2b = steady_icoarse;
+        config_fields.FCAL_EN_1b = 0;
+        load_values_into_regfile();
+        spi_write24(14, regfile[14]);
+    }
+    fastlock_result = lock_time;
+}
+
+void LMX2592::set_cal_profile(lmx2592_cal_profile profile) {
+    cal_profile = profile;
+}
+
+int LMX2592::vco_core_bin(double vco_hz) {
+    int bin = (int) ((vco_hz - VCO_MIN_HZ) * VCO_CORE_BINS / (VCO_MAX_HZ - VCO_MIN_HZ));
+    if (bin < 0) bin = 0;
+    if (bin >= VCO_CORE_BINS) bin = VCO_CORE_BINS - 1;
+    return bin;
+}
 
-    // handle MASH recommendations and stuff
-    // go for third order when possible
-    uint16_t mash_order = 3;
-    uint16_t pfd_delay = 2;
-    if (N_divider < 18) {
-        mash_order = 2;
-        pfd_delay = 2;
-    }  
-    if (N_divider < 16) {
-        mash_order = 1;
-        pfd_delay = 1;
+void LMX2592::apply_cal_profile(lmx2592_fields& f, double vco_hz) {
+    if (cal_profile == CAL_DEFAULT) {
+        // boot defaults, the calibration starts from scratch every time
+        f.CAL_CLK_DIV_3b = 3;
+        f.FJUMP_SIZE_4b = 15;
+        f.AJUMP_SIZE_3b = 3;
+        f.FCAL_FAST_1b = 0;
+        f.ACAL_FAST_1b = 0;
+        f.FCAL_VCO_SEL_STRT_1b = 0;
+        f.VCO_SEL_3b = 1;
+        return;
     }
-    // MASH order 0 is too shit so we dont use it
-    config_fields.MASH_ORDER_3b = mash_order;
+
+    // run the state machine as fast as the reference allows, rather than at the worst-case OSCin / 8
+    uint16_t cal_clk_div = 0;
+    while (cal_clk_div < 3 && REF_HZ / (1 << cal_clk_div) > CAL_CLK_MAX_HZ)
+        cal_clk_div++;
+    f.CAL_CLK_DIV_3b = cal_clk_div;
+    f.FCAL_FAST_1b = 1;
+    f.ACAL_FAST_1b = 1;
+    f.FJUMP_SIZE_4b = FAST_FJUMP_SIZE;
+    f.AJUMP_SIZE_3b = FAST_AJUMP_SIZE;
+    f.FCAL_VCO_SEL_STRT_1b = 0;
+    f.VCO_SEL_3b = 1;
+
+    if (cal_profile == CAL_SEEDED) {
+        // start the core search at whatever core locked closest to this VCO frequency before. with nothing
+        // learned yet, guess from where the frequency sits in the VCO range (7 cores, roughly evenly spread)
+        int bin = vco_core_bin(vco_hz);
+        uint8_t core = 0;
+        for (int dist = 0; dist < VCO_CORE_BINS && core == 0; dist++) {
+            if (bin - dist >= 0 && vco_cores[bin - dist] != 0) core = vco_cores[bin - dist];
+            else if (bin + dist < VCO_CORE_BINS && vco_cores[bin + dist] != 0) core = vco_cores[bin + dist];
+        }
+        if (core == 0)
+            core = 1 + (uint8_t) (bin * 7 / VCO_CORE_BINS);
+        f.FCAL_VCO_SEL_STRT_1b = 1;
+        f.VCO_SEL_3b = core;
+    }
+}
+
+void LMX2592::learn_vco_core() {
+    readback_mode(true);
+    uint8_t core = (spi_read24(68) >> 5) & 0x7;
+    if (monitor_enabled) readback_mode(false);
+    else monitor_paused = false;
+    if (core >= 1 && core <= 7)
+        vco_cores[vco_core_bin(planned_vco_hz)] = core;
 }
 
 bool LMX2592::set_power_int(uint16_t power) {
@@ -117,116 +508,62 @@ bool LMX2592::set_power_int(uint16_t power) {
     return true;
 }
 
+uint16_t LMX2592::get_power_int() {
+    // undo the gap set_power_int() skips over (32 to 47 are register values 48 to 63)
+    uint16_t power = config_fields.OUTA_POW_6b;
+    return (power >= 48) ? power - 16 : power;
+}
+
 bool LMX2592::set_frequency(double freq_hz) {
-    if (freq_hz < OUT_MIN_HZ || freq_hz > OUT_MAX_HZ) return 0; // can't do that
-    config_fields.MULT_5b = 5;
-    config_fields.PLL_R_8b = 2; // post R = 2
-    config_fields.FCAL_HPFD_ADJ_2b = 1; // Fpfd = 100 - 150 MHz
-    config_fields.PLL_N_PRE_1b = 0; // divide by two
-    double pfd_freq = 5 * REF_HZ / 2; // 120 MHz
-    double divider;
-    if (freq_hz < VCO_MIN_HZ) { // must use channel divider
-        // THIS IS MODIFIED FROM THE DATASHEET!
-        const uint16_t datasheet_table_7_4[][8] = {
-            // OUT_MIN, OUT_MAX, SEG1_REG, SEG2_REG, SEG3_REG, MUX, TOTAL_DIV
-            {1775, 3550, 0, 0, 0, 1, 2},     // ÷2
-            {1184, 2200, 1, 0, 0, 1, 3},     // ÷3
-            {888,  1184, 0, 1, 0, 2, 4},     // ÷2 * ÷2
-            {592,  888,  1, 1, 0, 2, 6},     // ÷3 * ÷2
-            {444,  592,  0, 2, 0, 2, 8},     // ÷2 * ÷4
-            {296,  444,  0, 4, 0, 2, 12},    // ÷2 * ÷6
-            {222,  296,  0, 8, 0, 2, 16},    // ÷2 * ÷8
-            {148,  222,  1, 8, 0, 2, 24},    // ÷3 * ÷8
-            {111,  148,  0, 8, 1, 4, 32},    // ÷2 * ÷8 * ÷2
-            {99,   111,  1, 4, 1, 4, 36},    // ÷3 * ÷6 * ÷2
-            {74,   99,   1, 8, 1, 4, 48},    // ÷3 * ÷8 * ÷2
-            {56,   74,   0, 8, 2, 4, 64},    // ÷2 * ÷8 * ÷4
-            {37,   56,   0, 8, 4, 4, 96},    // ÷2 * ÷8 * ÷6
-            {28,   37,   0, 8, 8, 4, 128},   // ÷2 * ÷8 * ÷8
-            {20,   28,   1, 8, 8, 4, 192}    // ÷3 * ÷8 * ÷8
-        };
-        double total_division = 0;
-        for (int row = 0; row < 15; row++) {
-            double min_freq = 1'000'000.0 * (double) datasheet_table_7_4[row][0];
-            double max_freq = 1'000'000.0 * (double) datasheet_table_7_4[row][1];
-            uint16_t seg1_val = datasheet_table_7_4[row][2];
-            uint16_t seg2_val = datasheet_table_7_4[row][3];
-            uint16_t seg3_val = datasheet_table_7_4[row][4];
-
-            uint16_t mux_val = datasheet_table_7_4[row][5];
-            
-            total_division = (double) datasheet_table_7_4[row][6];
-
-            if ((min_freq <= freq_hz) && (max_freq >= freq_hz)) {
-                // this one works
-                config_fields.CHDIV_SEG1_1b = seg1_val;
-                config_fields.CHDIV_SEG2_4b = seg2_val;
-                config_fields.CHDIV_SEG3_3b = seg3_val;
-                config_fields.CHDIV_SEG_SEL_4b = mux_val;
-
-                break;
-            }
-        }
-        if (total_division < 1.0)
-            return 0; // valid range not found
-        double vco_freq = total_division * freq_hz;
-        divider = vco_freq / (2 * pfd_freq); // 2 is from the prescaler
-
-        // enable channel divider
-        config_fields.CHDIV_EN_1b = 1;
-        config_fields.CHDIV_DIST_PD_1b = 0;
-        config_fields.CHDIV_SEG1_EN_1b = 1;
-        config_fields.CHDIV_SEG2_EN_1b = 1;
-        config_fields.CHDIV_SEG3_EN_1b = 1;
-        config_fields.CHDIV_DISTA_EN_1b = 1;
-        config_fields.CHDIV_DISTB_EN_1b = 1;
-        // power down the VCO dist
-        config_fields.VCO_DISTA_PD_1b = 1;
-        config_fields.VCO_DISTB_PD_1b = 1;
-        // select CHDIV mux
-        config_fields.OUTA_MUX_2b = 0;
-        config_fields.OUTB_MUX_2b = 0;
-        
-    }
-    else {
-        if (freq_hz < VCO_MAX_HZ) {
-            // can use fundamental
-            divider = freq_hz / (2 * pfd_freq); // 2 is from the prescaler
-        }
-        else {
-            // must use doubler
-            config_fields.VCO_2X_EN_1b = 1; // enable vco doubler
-            config_fields.PLL_N_PRE_1b = 1; // with doubler, must also set PLL N prescaler to 4
-            divider = freq_hz / (4 * pfd_freq); // 4 is from prescaler
-        }
-        // disable channel divider
-        config_fields.CHDIV_EN_1b = 0;
-        config_fields.CHDIV_DIST_PD_1b = 1;
-        config_fields.CHDIV_SEG1_EN_1b = 0;
-        config_fields.CHDIV_SEG2_EN_1b = 0;
-        config_fields.CHDIV_SEG3_EN_1b = 0;
-        config_fields.CHDIV_DISTA_EN_1b = 0;
-        config_fields.CHDIV_DISTB_EN_1b = 0;
-        // power up the VCO dist
-        config_fields.VCO_DISTA_PD_1b = 0;
-        config_fields.VCO_DISTB_PD_1b = 0;
-        // select VCO mux
-        config_fields.OUTA_MUX_2b = 1;
-        config_fields.OUTB_MUX_2b = 1;
+    if (!plan_frequency(freq_hz)) return false;
+    if (!needs_fcal()) {
+        retune_without_fcal();
+        return true;
     }
-    
-
-    load_divider_into_config(divider);
-    load_values_into_regfile();
     write_all_values();
     do_fcal();
+    if (fastlock) finish_fastlock();
 
     return true;
 }
 
+bool LMX2592::plan_frequency(double freq_hz) {
+    double vco_freq;
+    if (!plan_fields(config_fields, freq_hz, vco_freq)) return 0; // can't do that
+    // a new VCO frequency needs a real calibration, drop anything a fast wake forced
+    config_fields.VCO_SEL_FORCE_1b = 0;
+    config_fields.VCO_CAPCTRL_OVR_1b = 0;
+    config_fields.VCO_IDAC_OVR_1b = 0;
+    planned_vco_hz = vco_freq;
+    apply_cal_profile(config_fields, planned_vco_hz);
+    if (fastlock) {
+        // acquire with the loop opened up, finish_fastlock() brings it back once we're locked
+        config_fields.CP_ICOARSE_2b = FASTLOCK_ICOARSE;
+        config_fields.CP_IUP_5b = FASTLOCK_IUPDN;
+        config_fields.CP_IDN_5b = FASTLOCK_IUPDN;
+    }
+    config_fields.FCAL_EN_1b = 0; // the write-out must not start a calibration before all registers are in
+    for (int a = 0; a < 71; a++)
+        previous_regfile[a] = regfile[a];
+    load_values_into_regfile();
+
+    return true;
+}
+
+void LMX2592::read_all_values(uint16_t* contents, uint32_t gap_us) {
+    readback_mode(true);
+    for (int addr = 0; addr < 71; addr++) {
+        contents[addr] = spi_read24(addr);
+        if (gap_us) sleep_us(gap_us);
+    }
+    readback_mode(false);
+}
+
 void LMX2592::dump_values(bool hex) {
     bool PRINT_MODE_TICSPRO = hex;
-    spi_write24(0, 0b0010001000010000); 
+    // all the bus work first, the (slow) printing after
+    uint16_t contents[71];
+    read_all_values(contents, 1000);
 
     printf("       | ");
     for (int i = 0; i < 16; i++) {
@@ -235,14 +572,7 @@ void LMX2592::dump_values(bool hex) {
 
     uint8_t addr = 0;
     for (addr = 0; addr < 71; addr++) {
-        gpio_put(GPIO_SPI_LMX_CS, 0);
-        uint8_t cmd = addr | (1 << 7); // READ mode
-        uint8_t read_contents[2];
-        spi_write_blocking(SPI_PORT, &cmd, 1);
-        spi_read_blocking(SPI_PORT, 0, read_contents, 2);
-        gpio_put(GPIO_SPI_LMX_CS, 1);
-        sleep_ms(1);
-        uint16_t contents_merged = (uint16_t)read_contents[1] | ((uint16_t)read_contents[0] << 8); 
+        uint16_t contents_merged = contents[addr];
 
         if (PRINT_MODE_TICSPRO) {
             printf("R%d 0x%02x%04x\n", addr, addr, contents_merged);
@@ -259,6 +589,237 @@ void LMX2592::dump_values(bool hex) {
     printf("\n\n\n");
 }
 
+uint32_t LMX2592::train_spi(lmx2592_link_result* results, int* num_results) {
+    // fixed slow rates, then the even divisions of clk_peri (which the SPI block can hit exactly) up to what
+    // the LMX2592 is specified for
+    uint32_t rates[MAX_LINK_RATES];
+    int num_rates = 0;
+    for (uint32_t rate = 500'000; rate < 8'000'000; rate *= 2)
+        rates[num_rates++] = rate;
+    uint32_t peri_hz = clock_get_hz(clk_peri);
+    static const uint32_t peri_divs[] = {16, 12, 10, 8, 6, 4, 2};
+    for (int d = 0; d < (int) count_of(peri_divs) && num_rates < MAX_LINK_RATES; d++) {
+        uint32_t rate = peri_hz / peri_divs[d];
+        if (rate >= 8'000'000 && rate <= SPI_MAX_HZ)
+            rates[num_rates++] = rate;
+    }
+    static const uint16_t patterns[] = {
+        0x0000, 0xffff, 0xaaaa, 0x5555, 0xa5a5, 0x5a5a, 0xff00, 0x00ff,
+        0x0001, 0x8000, 0x7ffe, 0x1234
+    };
+    const int ROUNDS = 4;
+
+    // MASH_SEED (R42/R43) is only picked up when the modulator restarts, so it is safe to scribble on.
+    // it is restored from the shadow image afterwards
+    spi_baud = rates[0];
+    readback_mode(true);
+
+    int count = 0;
+    int highest_pass = -1;
+    for (int r = 0; r < num_rates; r++) {
+        spi_baud = rates[r];
+        select_baud();
+        spi_baud = spi_get_baudrate(pins.spi); // what the divider could actually do
+        bus_baud[spi_get_index(pins.spi)] = spi_baud;
+        if (count > 0 && results[count - 1].baud == spi_baud) continue;
+
+        uint16_t errors = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            for (int p = 0; p < (int) count_of(patterns); p++) {
+                uint16_t pattern = patterns[p] ^ (round & 1 ? 0xffff : 0);
+                spi_write24(43, pattern);
+                spi_write24(42, ~pattern);
+                if (spi_read24(43) != pattern) errors++;
+                if (spi_read24(42) != (uint16_t) ~pattern) errors++;
+            }
+        }
+        results[count].baud = spi_baud;
+        results[count].errors = errors;
+        count++;
+        if (errors != 0) break;
+        highest_pass = count - 1;
+    }
+    *num_results = count;
+
+    // leave one step of margin below the highest passing rate, unless nothing above it failed
+    int chosen = highest_pass;
+    if (chosen > 0 && results[count - 1].errors != 0)
+        chosen--;
+    spi_baud = (chosen >= 0) ? results[chosen].baud : rates[0];
+
+    spi_write24(43, regfile[43]);
+    spi_write24(42, regfile[42]);
+    readback_mode(false);
+    return spi_baud;
+}
+
+LMX2592* LMX2592::monitored[MAX_MONITORED] = {};
+
+void LMX_HOT(LMX2592::lock_monitor_irq)(uint gpio, uint32_t events) {
+    for (int i = 0; i < MAX_MONITORED; i++) {
+        LMX2592* dev = monitored[i];
+        if (dev != nullptr && dev->pins.muxout == gpio)
+            dev->on_lock_edge(events);
+    }
+}
+
+void LMX_HOT(LMX2592::on_lock_edge)(uint32_t events) {
+    if (monitor_paused) return;
+    bool locked = gpio_get(pins.muxout);
+    if (locked == last_lock_level) return; // both edges in one go, nothing changed for us
+    last_lock_level = locked;
+    uint64_t now = time_us_64();
+
+    if ((uint32_t) ((uint32_t) now - fcal_time_us) < FCAL_SETTLE_US) {
+        // we asked for this with an FCAL, it is not an integrity problem
+        return;
+    }
+
+    uint32_t head = lock_log_head;
+    lock_log[head % LOCK_LOG_SIZE].time_us = now;
+    lock_log[head % LOCK_LOG_SIZE].locked = locked;
+    lock_log_head = head + 1;
+
+    if (!locked) {
+        fcal_valid = false;
+        unlock_count = unlock_count + 1;
+        unlock_time_us = now;
+        if (auto_relock) relock_pending = true;
+        log_event(LOG_WARN, EV_UNLOCK, device_index);
+    }
+    else {
+        relock_count = relock_count + 1;
+        uint32_t recovery = (uint32_t) (now - unlock_time_us);
+        last_recovery_us = recovery;
+        if (recovery > max_recovery_us) max_recovery_us = recovery;
+        log_event(LOG_WARN, EV_RELOCK, device_index, recovery);
+    }
+}
+
+bool LMX2592::enable_lock_monitor(bool enabled, bool relock) {
+    int slot = -1;
+    for (int i = 0; i < MAX_MONITORED; i++) {
+        if (monitored[i] == this) slot = i;
+        // lock detect edges can only be told apart with a MUXOUT pin to ourselves
+        else if (monitored[i] != nullptr && monitored[i]->pins.muxout == pins.muxout && enabled) return false;
+    }
+
+    if (!enabled) {
+        monitor_enabled = false;
+        auto_relock = false;
+        relock_pending = false;
+        gpio_set_irq_enabled(pins.muxout, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
+        if (slot >= 0) monitored[slot] = nullptr;
+        return true;
+    }
+
+    if (slot < 0) {
+        for (int i = 0; i < MAX_MONITORED && slot < 0; i++) {
+            if (monitored[i] == nullptr) slot = i;
+        }
+        if (slot < 0) return false;
+        monitored[slot] = this;
+    }
+    auto_relock = relock;
+    monitor_enabled = true;
+    readback_mode(false); // MUXOUT to lock detect, and take the current level as the starting point
+    gpio_set_irq_enabled_with_callback(pins.muxout, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true, &lock_monitor_irq);
+    return true;
+}
+
+void LMX2592::service_lock_monitor() {
+    // the FCAL goes out from thread context so it can never land in the middle of somebody else's frame
+    if (!relock_pending) return;
+    relock_pending = false;
+    auto_relock_count++;
+    log_event(LOG_INFO, EV_AUTO_RELOCK, device_index);
+    config_fields.FCAL_EN_1b = 1;
+    load_values_into_regfile();
+    spi_write24(0, regfile[0]);
+    fcal_count++;
+    fcal_valid = false; // until wait_for_lock() sees it lock
+}
+
+int LMX2592::get_lock_log(lmx2592_lock_event* events, int max_events) {
+    uint32_t head = lock_log_head;
+    uint32_t count = head < LOCK_LOG_SIZE ? head : LOCK_LOG_SIZE;
+    if (count > (uint32_t) max_events) count = max_events;
+    for (uint32_t i = 0; i < count; i++) {
+        events[i] = lock_log[(head - count + i) % LOCK_LOG_SIZE];
+    }
+    return count;
+}
+
+void LMX2592::clear_lock_log() {
+    lock_log_head = 0;
+    unlock_count = 0;
+    relock_count = 0;
+    auto_relock_count = 0;
+    last_recovery_us = 0;
+    max_recovery_us = 0;
+}
+
+void LMX2592::standby() {
+    if (config_fields.POWERDOWN_1b) return;
+    // keep what the last calibration settled on, so waking up doesn't need another one
+    readback_mode(true);
+    config_fields.rb_VCO_SEL_3b = (spi_read24(68) >> 5) & 0x7;
+    config_fields.rb_VCO_CAPCTRL_8b = spi_read24(69) & 0xff;
+    config_fields.rb_VCO_DACISET_9b = spi_read24(70) & 0x1ff;
+    // lock detect stays paused until we're back up
+
+    config_fields.POWERDOWN_1b = 1;
+    config_fields.FCAL_EN_1b = 0;
+    load_values_into_regfile();
+    spi_write24(0, regfile[0]);
+    fcal_valid = false;
+}
+
+int LMX2592::wake(uint32_t timeout_us, bool* recalibrated) {
+    *recalibrated = false;
+    if (!config_fields.POWERDOWN_1b) return 0;
+    uint64_t start_time = time_us_64();
+
+    // everything else survived in the device, only force the VCO back to where it was and power up
+    config_fields.VCO_SEL_FORCE_1b = 1;
+    config_fields.VCO_SEL_3b = config_fields.rb_VCO_SEL_3b;
+    config_fields.VCO_CAPCTRL_OVR_1b = 1;
+    config_fields.VCO_CAPCTRL_8b = config_fields.rb_VCO_CAPCTRL_8b;
+    config_fields.VCO_IDAC_OVR_1b = 1;
+    config_fields.VCO_IDAC_9b = config_fields.rb_VCO_DACISET_9b;
+    config_fields.POWERDOWN_1b = 0;
+    config_fields.FCAL_EN_1b = 0;
+    config_fields.MUXOUT_SEL_1b = 0; // lock gets polled over SPI until we're sure we're back
+    load_values_into_regfile();
+    spi_write24(23, regfile[23]);
+    spi_write24(22, regfile[22]);
+    spi_write24(19, regfile[19]);
+    spi_write24(8, regfile[8]);
+    spi_write24(0, regfile[0]);
+
+    uint32_t waited = (uint32_t) (time_us_64() - start_time);
+    int lock_time = (waited < timeout_us) ? wait_for_lock(timeout_us - waited) : -1;
+    if (lock_time < 0) {
+        // the forced settings didn't hold (temperature moved too far?), fall back to a normal calibration
+        *recalibrated = true;
+        config_fields.VCO_SEL_FORCE_1b = 0;
+        config_fields.VCO_CAPCTRL_OVR_1b = 0;
+        config_fields.VCO_IDAC_OVR_1b = 0;
+        apply_cal_profile(config_fields, planned_vco_hz);
+        load_values_into_regfile();
+        spi_write24(23, regfile[23]);
+        spi_write24(22, regfile[22]);
+        spi_write24(19, regfile[19]);
+        spi_write24(8, regfile[8]);
+        do_fcal();
+        lock_time = wait_for_lock(timeout_us);
+    }
+    if (monitor_enabled) readback_mode(false);
+    else monitor_paused = false;
+    if (lock_time < 0) return -1;
+    return (int) (time_us_64() - start_time);
+}
+
 void LMX2592::enable_rf1(bool enabled) {
     config_fields.OUTA_PD_1b = !enabled;
     load_values_into_regfile();
@@ -270,25 +831,23 @@ void LMX2592::enable_rf2(bool enabled) {
     spi_write24(46, regfile[46]);
 }
 
-bool LMX2592::is_locked() {
+bool LMX_HOT(LMX2592::is_locked)() {
+    if (monitor_enabled && !monitor_paused) {
+        // MUXOUT is already showing lock detect, no need to go over SPI
+        return gpio_get(pins.muxout);
+    }
     config_fields.MUXOUT_SEL_1b = 0; // ensure readback mode
     config_fields.FCAL_EN_1b = 0; // dont fcal here
     load_values_into_regfile();
     spi_write24(0, regfile[0]);
 
-    uint8_t cmd = 68 | (1 << 7); // register 68, and READ bit set
-    uint8_t read_contents[2];
-    gpio_put(GPIO_SPI_LMX_CS, 0);
-    spi_write_blocking(SPI_PORT, &cmd, 1);
-    spi_read_blocking(SPI_PORT, 0, read_contents, 2);
-    gpio_put(GPIO_SPI_LMX_CS, 1);
     // we look for rb_LD_VTUNE register (bits 10:9 of R68)
-    uint16_t rb_LD_VTUNE = (read_contents[0] >> 1) % 0b11;
+    uint16_t rb_LD_VTUNE = (spi_read24(68) >> 9) & 0b11;
 
     return rb_LD_VTUNE == 2;
 }
 
-void LMX2592::write_all_values() {
+void LMX_HOT(LMX2592::write_all_values)() {
     for (int i = 70; i >= 0; i--) {
         if (write_detect[i]) {
             spi_write24(i & 0xff, regfile[i]);
@@ -296,380 +855,191 @@ void LMX2592::write_all_values() {
     }
 }
 
-void LMX2592::load_values_into_regfile() {
+void LMX_HOT(LMX2592::load_values_into_regfile)() {
+    pack_fields(config_fields, regfile, write_detect);
+}
+
+bool LMX2592::load_image_into_config(const uint16_t* image, const bool* present, bool* bad) {
+    lmx2592_fields backup = config_fields;
+    load_values_into_regfile();
     for (int i = 0; i < 71; i++) {
-        regfile[i] = 0;
-        write_detect[i] = false;
+        if (present[i] && write_detect[i]) regfile[i] = image[i];
     }
+    load_regfile_into_config();
+
+    // packing the fields back up has to give the same words, otherwise reserved bits were set differently
+    load_values_into_regfile();
+    bool ok = true;
+    for (int i = 0; i < 71; i++) {
+        bad[i] = present[i] && write_detect[i] && (regfile[i] != image[i]);
+        if (bad[i]) ok = false;
+    }
+    if (!ok) {
+        config_fields = backup;
+        load_values_into_regfile();
+        return false;
+    }
+
+    // we do the one calibration ourselves once everything is written, and never want a reset from an image
+    config_fields.RESET_1b = 0;
+    config_fields.FCAL_EN_1b = 0;
+    if (monitor_enabled) config_fields.MUXOUT_SEL_1b = 1; // the monitor needs lock detect on MUXOUT
+    load_values_into_regfile();
+    return true;
+}
+
+bool LMX2592::is_managed_register(uint8_t address) {
+    load_values_into_regfile();
+    return address < 71 && write_detect[address];
+}
+
+void LMX2592::load_regfile_into_config() {
+    // the inverse of load_values_into_regfile(), reserved bits are dropped
     // R0
-    regfile[0] = 0b0000001000000000;
-    regfile[0] |= ((config_fields.POWERDOWN_1b & 0x1) << 0);
-    regfile[0] |= ((config_fields.RESET_1b & 0x1) << 1);
-    regfile[0] |= ((config_fields.MUXOUT_SEL_1b & 0x1) << 2);
-    regfile[0] |= ((config_fields.FCAL_EN_1b & 0x1) << 3);
-    regfile[0] |= ((config_fields.ACAL_EN_1b & 0x1) << 4);
-    regfile[0] |= ((config_fields.FCAL_LPFD_ADJ_2b & 0x3) << 5);
-    regfile[0] |= ((config_fields.FCAL_HPFD_ADJ_2b & 0x3) << 7);
-    regfile[0] |= ((config_fields.LD_EN_1b & 0x1) << 13);
+    config_fields.POWERDOWN_1b = (regfile[0] >> 0) & 0x1;
+    config_fields.RESET_1b = (regfile[0] >> 1) & 0x1;
+    config_fields.MUXOUT_SEL_1b = (regfile[0] >> 2) & 0x1;
+    config_fields.FCAL_EN_1b = (regfile[0] >> 3) & 0x1;
+    config_fields.ACAL_EN_1b = (regfile[0] >> 4) & 0x1;
+    config_fields.FCAL_LPFD_ADJ_2b = (regfile[0] >> 5) & 0x3;
+    config_fields.FCAL_HPFD_ADJ_2b = (regfile[0] >> 7) & 0x3;
+    config_fields.LD_EN_1b = (regfile[0] >> 13) & 0x1;
 
     // R1
-    regfile[1] = 0b0000100000001000;
-    regfile[1] |= ((config_fields.CAL_CLK_DIV_3b & 0x7) << 0);
-
-    // R2
-    regfile[2] = 0b0000010100000000;
+    config_fields.CAL_CLK_DIV_3b = (regfile[1] >> 0) & 0x7;
 
     // R4
-    regfile[4] = 0b0000000001000011;
-    regfile[4] |= ((config_fields.ACAL_CMP_DLY_8b & 0xff) << 8);
-
-    // R7
-    regfile[7] = 0b0010100010110010;
+    config_fields.ACAL_CMP_DLY_8b = (regfile[4] >> 8) & 0xff;
 
     // R8
-    regfile[8] = 0b0001000010000100;
-    regfile[8] |= ((config_fields.VCO_CAPCTRL_OVR_1b & 0x1) << 10);
-    regfile[8] |= ((config_fields.VCO_IDAC_OVR_1b & 0x1) << 13);
+    config_fields.VCO_CAPCTRL_OVR_1b = (regfile[8] >> 10) & 0x1;
+    config_fields.VCO_IDAC_OVR_1b = (regfile[8] >> 13) & 0x1;
 
     // R9
-    regfile[9] = 0b0000000100000010;
-    regfile[9] |= ((config_fields.REF_EN_1b & 0x1) << 9);
-    regfile[9] |= ((config_fields.OSC_2X_1b & 0x1) << 11);
+    config_fields.REF_EN_1b = (regfile[9] >> 9) & 0x1;
+    config_fields.OSC_2X_1b = (regfile[9] >> 11) & 0x1;
 
     // R10
-    regfile[10] = 0b0001000001011000;
-    regfile[10] |= ((config_fields.MULT_5b & 0x1f) << 7);
+    config_fields.MULT_5b = (regfile[10] >> 7) & 0x1f;
 
     // R11
-    regfile[11] = 0b0000000000001000;
-    regfile[11] |= ((config_fields.PLL_R_8b & 0xff) << 4);
+    config_fields.PLL_R_8b = (regfile[11] >> 4) & 0xff;
 
     // R12
-    regfile[12] = 0b0111000000000000;
-    regfile[12] |= ((config_fields.PLL_R_PRE_12b & 0xfff) << 0);
+    config_fields.PLL_R_PRE_12b = (regfile[12] >> 0) & 0xfff;
 
     // R13
-    regfile[13] = 0b0000000000000000;
-    regfile[13] |= ((config_fields.PFD_CTL_2b & 0x3) << 0);
-    regfile[13] |= ((config_fields.CP_EN_1b & 0x1) << 14);
+    config_fields.PFD_CTL_2b = (regfile[13] >> 0) & 0x3;
+    config_fields.CP_EN_1b = (regfile[13] >> 14) & 0x1;
 
     // R14
-    regfile[14] = 0b0000000000000000;
-    regfile[14] |= ((config_fields.CP_ICOARSE_2b & 0x3) << 0);
-    regfile[14] |= ((config_fields.CP_IUP_5b & 0x1f) << 2);
-    regfile[14] |= ((config_fields.CP_IDN_5b & 0x1f) << 7);
+    config_fields.CP_ICOARSE_2b = (regfile[14] >> 0) & 0x3;
+    config_fields.CP_IUP_5b = (regfile[14] >> 2) & 0x1f;
+    config_fields.CP_IDN_5b = (regfile[14] >> 7) & 0x1f;
 
     // R19
-    regfile[19] = 0b0000000000000101;
-    regfile[19] |= ((config_fields.VCO_IDAC_9b & 0x1ff) << 3);
+    config_fields.VCO_IDAC_9b = (regfile[19] >> 3) & 0x1ff;
 
     // R20
-    regfile[20] = 0b0000000000000000;
-    regfile[20] |= ((config_fields.ACAL_VCO_IDAC_STRT_9b & 0x1ff) << 0);
+    config_fields.ACAL_VCO_IDAC_STRT_9b = (regfile[20] >> 0) & 0x1ff;
 
     // R22
-    regfile[22] = 0b0010001100000000;
-    regfile[22] |= ((config_fields.VCO_CAPCTRL_8b & 0xff) << 0);
+    config_fields.VCO_CAPCTRL_8b = (regfile[22] >> 0) & 0xff;
 
     // R23
-    regfile[23] = 0b1000000001000010;
-    regfile[23] |= ((config_fields.VCO_SEL_FORCE_1b & 0x1) << 10);
-    regfile[23] |= ((config_fields.VCO_SEL_3b & 0x7) << 11);
-    regfile[23] |= ((config_fields.FCAL_VCO_SEL_STRT_1b & 0x1) << 14);
-
-    // R24
-    regfile[24] = 0b0000010100001001;
-
-    // R25
-    regfile[25] = 0b0000000000000000;
-
-    // R28
-    regfile[28] = 0b0010100100100100;
-
-    // R29
-    regfile[29] = 0b0000000010000100;
+    config_fields.VCO_SEL_FORCE_1b = (regfile[23] >> 10) & 0x1;
+    config_fields.VCO_SEL_3b = (regfile[23] >> 11) & 0x7;
+    config_fields.FCAL_VCO_SEL_STRT_1b = (regfile[23] >> 14) & 0x1;
 
     // R30
-    regfile[30] = 0b0000000000110100;
-    regfile[30] |= ((config_fields.VCO_2X_EN_1b & 0x1) << 0);
-    regfile[30] |= ((config_fields.VTUNE_ADJ_2b & 0x3) << 6);
-    regfile[30] |= ((config_fields.MASH_DITHER_1b & 0x1) << 10);
+    config_fields.VCO_2X_EN_1b = (regfile[30] >> 0) & 0x1;
+    config_fields.VTUNE_ADJ_2b = (regfile[30] >> 6) & 0x3;
+    config_fields.MASH_DITHER_1b = (regfile[30] >> 10) & 0x1;
 
     // R31
-    regfile[31] = 0b0000000000000001;
-    regfile[31] |= ((config_fields.CHDIV_DIST_PD_1b & 0x1) << 7);
-    regfile[31] |= ((config_fields.VCO_DISTA_PD_1b & 0x1) << 9);
-    regfile[31] |= ((config_fields.VCO_DISTB_PD_1b & 0x1) << 10);
-
-    // R32
-    regfile[32] = 0b0010000100001010;
-
-    // R33
-    regfile[33] = 0b0010101000001010;
+    config_fields.CHDIV_DIST_PD_1b = (regfile[31] >> 7) & 0x1;
+    config_fields.VCO_DISTA_PD_1b = (regfile[31] >> 9) & 0x1;
+    config_fields.VCO_DISTB_PD_1b = (regfile[31] >> 10) & 0x1;
 
     // R34
-    regfile[34] = 0b1100001111001010;
-    regfile[34] |= ((config_fields.CHDIV_EN_1b & 0x1) << 5);
+    config_fields.CHDIV_EN_1b = (regfile[34] >> 5) & 0x1;
 
     // R35
-    regfile[35] = 0b0000000000011001;
-    regfile[35] |= ((config_fields.CHDIV_SEG1_EN_1b & 0x1) << 1);
-    regfile[35] |= ((config_fields.CHDIV_SEG1_1b & 0x1) << 2);
-    regfile[35] |= ((config_fields.CHDIV_SEG2_EN_1b & 0x1) << 7);
-    regfile[35] |= ((config_fields.CHDIV_SEG3_EN_1b & 0x1) << 8);
-    regfile[35] |= ((config_fields.CHDIV_SEG2_4b & 0xf) << 9);
+    config_fields.CHDIV_SEG1_EN_1b = (regfile[35] >> 1) & 0x1;
+    config_fields.CHDIV_SEG1_1b = (regfile[35] >> 2) & 0x1;
+    config_fields.CHDIV_SEG2_EN_1b = (regfile[35] >> 7) & 0x1;
+    config_fields.CHDIV_SEG3_EN_1b = (regfile[35] >> 8) & 0x1;
+    config_fields.CHDIV_SEG2_4b = (regfile[35] >> 9) & 0xf;
 
     // R36
-    regfile[36] = 0b0000000000000000;
-    regfile[36] |= ((config_fields.CHDIV_SEG3_3b & 0xf) << 0);
-    regfile[36] |= ((config_fields.CHDIV_SEG_SEL_4b & 0x7) << 4);
-    regfile[36] |= ((config_fields.CHDIV_DISTA_EN_1b & 0x1) << 10);
-    regfile[36] |= ((config_fields.CHDIV_DISTB_EN_1b & 0x1) << 11);
+    config_fields.CHDIV_SEG3_3b = (regfile[36] >> 0) & 0xf;
+    config_fields.CHDIV_SEG_SEL_4b = (regfile[36] >> 4) & 0x7;
+    config_fields.CHDIV_DISTA_EN_1b = (regfile[36] >> 10) & 0x1;
+    config_fields.CHDIV_DISTB_EN_1b = (regfile[36] >> 11) & 0x1;
 
     // R37
-    regfile[37] = 0b0100000000000000;
-    regfile[37] |= ((config_fields.PLL_N_PRE_1b & 0x1) << 12);
+    config_fields.PLL_N_PRE_1b = (regfile[37] >> 12) & 0x1;
 
     // R38
-    regfile[38] = 0b0000000000000000;
-    regfile[38] |= ((config_fields.PLL_N_12b & 0xfff) << 1);
+    config_fields.PLL_N_12b = (regfile[38] >> 1) & 0xfff;
 
     // R39
-    regfile[39] = 0b1000000000000100;
-    regfile[39] |= ((config_fields.PFD_DLY_6b & 0x3f) << 8);
+    config_fields.PFD_DLY_6b = (regfile[39] >> 8) & 0x3f;
 
     // R40
-    regfile[40] = 0b0000000000000000;
-    regfile[40] |= ((config_fields.PLL_DEN_31_16__16b & 0xffff) << 0);
+    config_fields.PLL_DEN_31_16__16b = (regfile[40] >> 0) & 0xffff;
 
     // R41
-    regfile[41] = 0b0000000000000000;
-    regfile[41] |= ((config_fields.PLL_DEN_15_0__16b & 0xffff) << 0);
+    config_fields.PLL_DEN_15_0__16b = (regfile[41] >> 0) & 0xffff;
 
     // R42
-    regfile[42] = 0b0000000000000000;
-    regfile[42] |= ((config_fields.MASH_SEED_31_16__16b & 0xffff) << 0);
+    config_fields.MASH_SEED_31_16__16b = (regfile[42] >> 0) & 0xffff;
 
     // R43
-    regfile[43] = 0b0000000000000000;
-    regfile[43] |= ((config_fields.MASH_SEED_15_0__16b & 0xffff) << 0);
+    config_fields.MASH_SEED_15_0__16b = (regfile[43] >> 0) & 0xffff;
 
     // R44
-    regfile[44] = 0b0000000000000000;
-    regfile[44] |= ((config_fields.PLL_NUM_31_16__16b & 0xffff) << 0);
+    config_fields.PLL_NUM_31_16__16b = (regfile[44] >> 0) & 0xffff;
 
     // R45
-    regfile[45] = 0b0000000000000000;
-    regfile[45] |= ((config_fields.PLL_NUM_15_0__16b & 0xffff) << 0);
+    config_fields.PLL_NUM_15_0__16b = (regfile[45] >> 0) & 0xffff;
 
     // R46
-    regfile[46] = 0b0000000000100000;
-    regfile[46] |= ((config_fields.MASH_ORDER_3b & 0x7) << 0);
-    regfile[46] |= ((config_fields.OUTA_PD_1b & 0x1) << 6);
-    regfile[46] |= ((config_fields.OUTB_PD_1b & 0x1) << 7);
-    regfile[46] |= ((config_fields.OUTA_POW_6b & 0x3f) << 8);
+    config_fields.MASH_ORDER_3b = (regfile[46] >> 0) & 0x7;
+    config_fields.OUTA_PD_1b = (regfile[46] >> 6) & 0x1;
+    config_fields.OUTB_PD_1b = (regfile[46] >> 7) & 0x1;
+    config_fields.OUTA_POW_6b = (regfile[46] >> 8) & 0x3f;
 
     // R47
-    regfile[47] = 0b0000000011000000;
-    regfile[47] |= ((config_fields.OUTB_POW_6b & 0x3f) << 0);
-    regfile[47] |= ((config_fields.OUTA_MUX_2b & 0x3) << 11);
+    config_fields.OUTB_POW_6b = (regfile[47] >> 0) & 0x3f;
+    config_fields.OUTA_MUX_2b = (regfile[47] >> 11) & 0x3;
 
     // R48
-    regfile[48] = 0b0000001111111100;
-    regfile[48] |= ((config_fields.OUTB_MUX_2b & 0x3) << 0);
+    config_fields.OUTB_MUX_2b = (regfile[48] >> 0) & 0x3;
 
     // R59
-    regfile[59] = 0b0000000000000000;
-    regfile[59] |= ((config_fields.MUXOUT_HDRV_1b & 0x1) << 5);
+    config_fields.MUXOUT_HDRV_1b = (regfile[59] >> 5) & 0x1;
 
     // R61
-    regfile[61] = 0b0000000000000000;
-    regfile[61] |= ((config_fields.LD_TYPE_1b & 0x1) << 0);
-
-    // R62
-    regfile[62] = 0b0000000000000000;
+    config_fields.LD_TYPE_1b = (regfile[61] >> 0) & 0x1;
 
     // R64
-    regfile[64] = 0b0000000000010000;
-    regfile[64] |= ((config_fields.FJUMP_SIZE_4b & 0xf) << 0);
-    regfile[64] |= ((config_fields.AJUMP_SIZE_3b & 0x7) << 5);
-    regfile[64] |= ((config_fields.FCAL_FAST_1b & 0x1) << 8);
-    regfile[64] |= ((config_fields.ACAL_FAST_1b & 0x1) << 9);
+    config_fields.FJUMP_SIZE_4b = (regfile[64] >> 0) & 0xf;
+    config_fields.AJUMP_SIZE_3b = (regfile[64] >> 5) & 0x7;
+    config_fields.FCAL_FAST_1b = (regfile[64] >> 8) & 0x1;
+    config_fields.ACAL_FAST_1b = (regfile[64] >> 9) & 0x1;
 
     // R68
-    regfile[68] = 0b0000000000000000;
-    regfile[68] |= ((config_fields.rb_VCO_SEL_3b & 0x7) << 5);
-    regfile[68] |= ((config_fields.rb_LD_VTUNE_2b & 0x3) << 9);
+    config_fields.rb_VCO_SEL_3b = (regfile[68] >> 5) & 0x7;
+    config_fields.rb_LD_VTUNE_2b = (regfile[68] >> 9) & 0x3;
 
     // R69
-    regfile[69] = 0b0000000000000000;
-    regfile[69] |= ((config_fields.rb_VCO_CAPCTRL_8b & 0xff) << 0);
+    config_fields.rb_VCO_CAPCTRL_8b = (regfile[69] >> 0) & 0xff;
 
     // R70
-    regfile[70] = 0b0000000000000000;
-    regfile[70] |= ((config_fields.rb_VCO_DACISET_9b & 0x1ff) << 0);
-
-    // mark the ones to be written
-    write_detect[0] = true;
-    write_detect[1] = true;
-    write_detect[2] = true;
-    write_detect[4] = true;
-    write_detect[7] = true;
-    write_detect[8] = true;
-    write_detect[9] = true;
-    write_detect[10] = true;
-    write_detect[11] = true;
-    write_detect[12] = true;
-    write_detect[13] = true;
-    write_detect[14] = true;
-    write_detect[19] = true;
-    write_detect[20] = true;
-    write_detect[22] = true;
-    write_detect[23] = true;
-    write_detect[24] = true;
-    write_detect[25] = true;
-    write_detect[28] = true;
-    write_detect[29] = true;
-    write_detect[30] = true;
-    write_detect[31] = true;
-    write_detect[32] = true;
-    write_detect[33] = true;
-    write_detect[34] = true;
-    write_detect[35] = true;
-    write_detect[36] = true;
-    write_detect[37] = true;
-    write_detect[38] = true;
-    write_detect[39] = true;
-    write_detect[40] = true;
-    write_detect[41] = true;
-    write_detect[42] = true;
-    write_detect[43] = true;
-    write_detect[44] = true;
-    write_detect[45] = true;
-    write_detect[46] = true;
-    write_detect[47] = true;
-    write_detect[48] = true;
-    write_detect[59] = true;
-    write_detect[61] = true;
-    write_detect[62] = true;
-    write_detect[64] = true;
+    config_fields.rb_VCO_DACISET_9b = (regfile[70] >> 0) & 0x1ff;
 }
 
 void LMX2592::load_defaults_into_config() {
-    // R0
-    config_fields.POWERDOWN_1b = 0;
-    config_fields.RESET_1b = 0;
-    config_fields.MUXOUT_SEL_1b = 1;
-    config_fields.FCAL_EN_1b = 0; // this is not default but we want to do this last.
-    config_fields.ACAL_EN_1b = 1;
-    config_fields.FCAL_LPFD_ADJ_2b = 0;
-    config_fields.FCAL_HPFD_ADJ_2b = 0;
-    config_fields.LD_EN_1b = 1;
-    // R1
-    config_fields.CAL_CLK_DIV_3b = 3;
-    // R2
-    // R4
-    config_fields.ACAL_CMP_DLY_8b = 25;
-    // R7
-    // R8
-    config_fields.VCO_CAPCTRL_OVR_1b = 0;
-    config_fields.VCO_IDAC_OVR_1b = 0;
-    // R9
-    config_fields.REF_EN_1b = 1;
-    config_fields.OSC_2X_1b = 0;
-    // R10
-    config_fields.MULT_5b = 1;
-    // R11
-    config_fields.PLL_R_8b = 1;
-    // R12
-    config_fields.PLL_R_PRE_12b = 1;
-    // R13
-    config_fields.PFD_CTL_2b = 0;
-    config_fields.CP_EN_1b = 1;
-    // R14
-    config_fields.CP_ICOARSE_2b = 1;
-    config_fields.CP_IUP_5b = 3;
-    config_fields.CP_IDN_5b = 3;
-    // R19
-    config_fields.VCO_IDAC_9b = 300;
-    // R20
-    config_fields.ACAL_VCO_IDAC_STRT_9b = 300;
-    // R22
-    config_fields.VCO_CAPCTRL_8b = 0;
-    // R23
-    config_fields.VCO_SEL_FORCE_1b = 0;
-    config_fields.VCO_SEL_3b = 1;
-    config_fields.FCAL_VCO_SEL_STRT_1b = 0;
-    // R24
-    // R25
-    // R28
-    // R29
-    // R30
-    config_fields.VCO_2X_EN_1b = 0;
-    config_fields.VTUNE_ADJ_2b = 0; // Change this register field according to the VCO frequency, 0: fVCO < 6500 MHz, 3: fVCO ≥ 6500 MHz
-    config_fields.MASH_DITHER_1b = 0;
-    // R31
-    config_fields.CHDIV_DIST_PD_1b = 0;
-    config_fields.VCO_DISTA_PD_1b = 0;
-    config_fields.VCO_DISTB_PD_1b = 1;
-    // R32
-    // R33
-    // R34
-    config_fields.CHDIV_EN_1b = 1;
-    // R35
-    config_fields.CHDIV_SEG1_EN_1b = 0;
-    config_fields.CHDIV_SEG1_1b = 1;
-    config_fields.CHDIV_SEG2_EN_1b = 0;
-    config_fields.CHDIV_SEG3_EN_1b = 0;
-    config_fields.CHDIV_SEG2_4b = 1;
-    // R36
-    config_fields.CHDIV_SEG3_3b = 1;
-    config_fields.CHDIV_SEG_SEL_4b = 1;
-    config_fields.CHDIV_DISTA_EN_1b = 1;
-    config_fields.CHDIV_DISTB_EN_1b = 0;
-    // R37
-    config_fields.PLL_N_PRE_1b = 0;
-    // R38
-    config_fields.PLL_N_12b = 27;
-    // R39
-    config_fields.PFD_DLY_6b = 2;
-    // R40
-    config_fields.PLL_DEN_31_16__16b = 1000;
-    // R41
-    config_fields.PLL_DEN_15_0__16b = 1000;
-    // R42
-    config_fields.MASH_SEED_31_16__16b = 0;
-    // R43
-    config_fields.MASH_SEED_15_0__16b = 0;
-    // R44
-    config_fields.PLL_NUM_31_16__16b = 0;
-    // R45
-    config_fields.PLL_NUM_15_0__16b = 0;
-    // R46
-    config_fields.MASH_ORDER_3b = 3;
-    config_fields.OUTA_PD_1b = 0;
-    config_fields.OUTB_PD_1b = 1;
-    config_fields.OUTA_POW_6b = 15;
-    // R47
-    config_fields.OUTB_POW_6b = 0;
-    config_fields.OUTA_MUX_2b = 0;
-    // R48
-    config_fields.OUTB_MUX_2b = 0;
-    // R59
-    config_fields.MUXOUT_HDRV_1b = 0;
-    // R61
-    config_fields.LD_TYPE_1b = 1;
-    // R62
-    // R64
-    config_fields.FJUMP_SIZE_4b = 15;
-    config_fields.AJUMP_SIZE_3b = 3;
-    config_fields.FCAL_FAST_1b = 0;
-    config_fields.ACAL_FAST_1b = 0;
-    // R68
-    config_fields.rb_VCO_SEL_3b = 0; // these ones are readback values!!
-    config_fields.rb_LD_VTUNE_2b = 0; // these ones are readback values!!
-    // R69
-    config_fields.rb_VCO_CAPCTRL_8b = 0; // these ones are readback values!!
-    // R70
-    config_fields.rb_VCO_DACISET_9b = 0; // these ones are readback values!!
-}
\ No newline at end of file
+    default_fields(config_fields);
+}
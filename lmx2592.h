@@ -1,5 +1,25 @@
 #pragma once 
 #include "pico/stdlib.h"
+#include "hardware/spi.h"
+
+// the performance build keeps the register write path, lock detect handling and sweep stepping in SRAM,
+// so XIP cache misses don't show up as jitter in SPI timing and lock measurements
+#if LMX_PERFORMANCE_BUILD
+#define LMX_HOT(func) __not_in_flash_func(func)
+#else
+#define LMX_HOT(func) func
+#endif
+
+// everything needed to talk to one LMX2592. devices may share an SPI bus (and SCK/MOSI/MUXOUT pins),
+// as long as each one has its own CS line
+struct lmx2592_pins {
+    spi_inst_t* spi;
+    uint sck;
+    uint mosi;
+    uint muxout; // MUXOUT is wired to the SPI RX pin, it is both readback and lock detect
+    uint cs;
+    uint en;
+};
 
 struct lmx2592_fields {
     // R0
@@ -165,30 +185,235 @@ struct lmx2592_fields {
     uint16_t rb_VCO_DACISET_9b;
 };
 
+// one step of SPI link training
+struct lmx2592_link_result {
+    uint32_t baud;
+    uint16_t errors;
+};
+
+// entry in the lock monitor's event ring
+struct lmx2592_lock_event {
+    uint64_t time_us;
+    bool locked;
+};
+
+// how the VCO calibration is set up on every retune
+enum lmx2592_cal_profile {
+    CAL_DEFAULT, // boot defaults: full search from core 1, slow state machine clock
+    CAL_FAST,    // fast FCAL/ACAL with tuned jump sizes, state machine clock set from the reference
+    CAL_SEEDED,  // CAL_FAST, plus the core search starts from the core that locked nearest this VCO frequency
+};
+
 class LMX2592 {
+public:
     static constexpr double VCO_MIN_HZ = 3'550'000'000.0;
     static constexpr double VCO_MAX_HZ = 7'100'000'000.0;
     static constexpr double OUT_MAX_HZ = 9'800'000'000.0;
     static constexpr double OUT_MIN_HZ =    20'000'000.0;
     static constexpr double REF_HZ = 48'000'000.0;
-
+private:
+    static constexpr uint32_t SPI_MAX_HZ = 75'000'000;
+    static constexpr double CAL_CLK_MAX_HZ = 200'000'000.0; // calibration state machine clock limit
+    static constexpr uint16_t FAST_FJUMP_SIZE = 4;
+    static constexpr uint16_t FAST_AJUMP_SIZE = 2;
+    static constexpr int VCO_CORE_BINS = 32; // over the VCO range, ~110 MHz each
+    static constexpr uint16_t FASTLOCK_ICOARSE = 3; // x2.5
+    static constexpr uint16_t FASTLOCK_IUPDN = 24;
+    static constexpr int FASTLOCK_STEPS = 4;
+    static constexpr uint32_t FASTLOCK_TIMEOUT_US = 10000;
+    static constexpr int FASTLOCK_NONE = -2;
+
+
+    lmx2592_pins pins;
+    uint32_t spi_baud = 500000;
+    bool pins_ready = false;
+    static uint32_t bus_baud[2]; // what each SPI block is currently clocked at
+
+    void select_baud();
+
+    // lock integrity monitor, fed by GPIO edge interrupts on MUXOUT (lock detect) so it costs no SPI traffic
+    static constexpr int LOCK_LOG_SIZE = 32;
+    static constexpr int MAX_MONITORED = 8;
+    static LMX2592* monitored[MAX_MONITORED];
+    lmx2592_lock_event lock_log[LOCK_LOG_SIZE];
+    volatile uint32_t lock_log_head = 0;
+    volatile bool monitor_enabled = false;
+    volatile bool monitor_paused = false;
+    volatile bool auto_relock = false;
+    volatile bool relock_pending = false;
+    static constexpr uint32_t FCAL_SETTLE_US = 10000;
+    volatile uint32_t fcal_time_us = 0; // lock edges this soon after our own FCALs are expected, not logged
+    volatile bool last_lock_level = false;
+    uint64_t unlock_time_us = 0;
+
+    static void lock_monitor_irq(uint gpio, uint32_t events);
+    void on_lock_edge(uint32_t events);
+    void readback_mode(bool enabled);
+
+    lmx2592_cal_profile cal_profile = CAL_DEFAULT;
+    double planned_vco_hz = 0;
+    uint8_t vco_cores[VCO_CORE_BINS] = {}; // VCO core that last locked in each bin, 0 if never seen
+
+    static int vco_core_bin(double vco_hz);
+    void learn_vco_core();
+
+    bool fastlock = false;
+    uint16_t steady_icoarse = 1;
+    uint16_t steady_iup = 3;
+    uint16_t steady_idn = 3;
+    int fastlock_result = FASTLOCK_NONE; // acquisition time from the last fast-lock retune, not yet collected
+
+    void finish_fastlock();
+    // writes and starts the FCAL, false if the retune kept the last one
+    bool start_registers(const uint8_t* addresses, const uint16_t* values, int count);
+    volatile bool retune_pending = false; // apply_registers_irq() left the lock wait to service_retune()
+
+    // a retune that leaves the VCO frequency and every calibration setting alone keeps the last FCAL, and only the
+    // divider, mux and doubler registers that changed go out
+    volatile bool fcal_valid = false; // the last FCAL was seen to lock. standby and unexpected unlocks clear it
+    uint16_t previous_regfile[71];    // the register file as it was before the last plan_frequency()
+    static constexpr uint16_t fcal_free_bits(uint8_t address);
+    bool needs_fcal();
+    void retune_without_fcal();
 
     uint16_t regfile[71];
     bool write_detect[71];
+
+    static void broadcast_write24(LMX2592* const* devs, int count, uint8_t address, uint16_t data);
 public:
+    // channel divider bands. THIS IS MODIFIED FROM THE DATASHEET! (table 7-4)
+    static constexpr int CHDIV_BANDS = 15;
+    static constexpr uint16_t chdiv_table[CHDIV_BANDS][7] = {
+        // OUT_MIN, OUT_MAX, SEG1_REG, SEG2_REG, SEG3_REG, MUX, TOTAL_DIV
+        {1775, 3550, 0, 0, 0, 1, 2},     // ÷2
+        {1184, 2200, 1, 0, 0, 1, 3},     // ÷3
+        {888,  1184, 0, 1, 0, 2, 4},     // ÷2 * ÷2
+        {592,  888,  1, 1, 0, 2, 6},     // ÷3 * ÷2
+        {444,  592,  0, 2, 0, 2, 8},     // ÷2 * ÷4
+        {296,  444,  0, 4, 0, 2, 12},    // ÷2 * ÷6
+        {222,  296,  0, 8, 0, 2, 16},    // ÷2 * ÷8
+        {148,  222,  1, 8, 0, 2, 24},    // ÷3 * ÷8
+        {111,  148,  0, 8, 1, 4, 32},    // ÷2 * ÷8 * ÷2
+        {99,   111,  1, 4, 1, 4, 36},    // ÷3 * ÷6 * ÷2
+        {74,   99,   1, 8, 1, 4, 48},    // ÷3 * ÷8 * ÷2
+        {56,   74,   0, 8, 2, 4, 64},    // ÷2 * ÷8 * ÷4
+        {37,   56,   0, 8, 4, 4, 96},    // ÷2 * ÷8 * ÷6
+        {28,   37,   0, 8, 8, 4, 128},   // ÷2 * ÷8 * ÷8
+        {20,   28,   1, 8, 8, 4, 192}    // ÷3 * ÷8 * ÷8
+    };
+
     lmx2592_fields config_fields;
+
+    volatile uint32_t unlock_count = 0;
+    volatile uint32_t relock_count = 0;
+    uint32_t auto_relock_count = 0;
+    volatile uint32_t last_recovery_us = 0;
+    volatile uint32_t max_recovery_us = 0;
+    int device_index = 0; // how log records name this device
+    // called between the polls of a lock wait, with nothing half written to any device. the test board lets
+    // scheduled commands out from here, so a wait doesn't hold them back
+    static void (*lock_wait_gap)();
+
+    LMX2592(const lmx2592_pins& pins);
+    void init_pins();
     void load_values_into_regfile();
+    void load_regfile_into_config();
     void load_defaults_into_config();
+    // takes a full register image (e.g. from TICS Pro) into config_fields, for the registers flagged in present.
+    // registers the driver doesn't manage are skipped. if reserved bits don't match what the driver writes, the
+    // offending registers are flagged in bad and the config is left alone
+    bool load_image_into_config(const uint16_t* image, const bool* present, bool* bad);
+    bool is_managed_register(uint8_t address);
+    static constexpr int MAX_LINK_RATES = 12;
+
     void spi_write24(uint8_t address, uint16_t data);
+    uint16_t spi_read24(uint8_t address);
     void init_spi();
+    // steps the SPI clock up, checking write/readback of test patterns at each rate. results needs room for
+    // MAX_LINK_RATES entries. returns (and from then on uses) the fastest rate that passed with a step of margin
+    uint32_t train_spi(lmx2592_link_result* results, int* num_results);
+    uint32_t get_spi_baud() { return spi_baud; }
+    uint get_cs_pin() { return pins.cs; }
+    uint32_t bus_frames = 0; // 24 bit frames clocked to or from this device
+    uint32_t fcal_count = 0;
+    uint32_t fcal_skipped = 0; // retunes that kept the VCO where it was and didn't need an FCAL
+    // reads back all 71 registers, gap_us apart
+    void read_all_values(uint16_t* contents, uint32_t gap_us);
     void dump_values(bool hex);
     void write_all_values();
     void soft_reset();
     void do_fcal();
     void load_divider_into_config(double divider);
+    // the pure parts of planning and packing, on a field set rather than the driver's own. constexpr, so fixed
+    // operating points can be worked out at compile time (lmx2592_regs.h has the definitions)
+    static constexpr void default_fields(lmx2592_fields& f);
+    static constexpr void pack_fields(const lmx2592_fields& f, uint16_t* regfile, bool* write_detect);
+    static constexpr void divider_fields(lmx2592_fields& f, double divider);
+    // output frequency, dividers and muxing only. calibration, fast-lock and overrides are up to the caller
+    static constexpr bool plan_fields(lmx2592_fields& f, double freq_hz, double& vco_freq);
+    bool plan_frequency(double freq_hz);
     bool set_frequency(double freq_hz);
+    // plans a frequency into image (71 registers) without touching the device or the driver's own state
+    bool plan_image(double freq_hz, uint16_t* image);
+    // writes precomputed register values (descending address order) to the device, skipping any it already has,
+    // brings the driver's state in line with them and calibrates. no planning involved
+    void apply_registers(const uint8_t* addresses, const uint16_t* values, int count);
+    // the same for an interrupt: only the writes and the FCAL. waiting for lock, and the fast-lock step-down and
+    // core learning that come with it, are left to service_retune()
+    void apply_registers_irq(const uint8_t* addresses, const uint16_t* values, int count);
+    // finishes a retune apply_registers_irq() started, from the idle loop. returns its lock time, -1 on a timeout,
+    // or FASTLOCK_NONE with nothing to finish
+    int service_retune();
+    // the same without the calibration, for settings that don't move the VCO (output power, enables)
+    // returns true if anything the VCO calibration depends on changed
+    bool write_registers(const uint8_t* addresses, const uint16_t* values, int count);
+    const uint16_t* get_regfile() { return regfile; }
+    double vco_from_config();
+    // output frequency the current configuration gives, through the doubler or channel divider. 0 if the divider
+    // settings don't match a chdiv_table band
+    double output_from_config();
     bool is_locked();
+    // with fast-lock on, every retune raises the charge pump current for acquisition, waits for lock, then steps
+    // it back to the steady-state setting with R14 writes only. wait_for_lock() then reports that acquisition time
+    void set_fastlock(bool enabled);
+    bool fastlock_enabled() { return fastlock; }
+    void set_cal_profile(lmx2592_cal_profile profile);
+    lmx2592_cal_profile get_cal_profile() { return cal_profile; }
+    // the current profile's calibration settings for a VCO frequency, into f: CAL_CLK_DIV, the jump sizes, fast
+    // FCAL/ACAL and the starting core
+    void apply_cal_profile(lmx2592_fields& f, double vco_hz);
+    double get_vco_hz() { return planned_vco_hz; }
+    // polls lock detect until it reports lock, returns how long that took in us, or -1 on timeout
+    int wait_for_lock(uint32_t timeout_us);
+
+    // start/stop watching lock detect in the background. with relock set, an unexpected unlock is answered with
+    // an FCAL from service_lock_monitor(), which should be called from the idle loop
+    bool enable_lock_monitor(bool enabled, bool relock);
+    bool lock_monitor_enabled() { return monitor_enabled; }
+    void service_lock_monitor();
+    // copies out the newest events (oldest first), returns how many
+    int get_lock_log(lmx2592_lock_event* events, int max_events);
+    void clear_lock_log();
     bool set_power_int(uint16_t power);
+    uint16_t get_power_int();
+    // powers the synthesizer down, keeping the register image and the VCO calibration results
+    void standby();
+    bool in_standby() { return config_fields.POWERDOWN_1b; }
+    // powers back up with the VCO forced to its pre-standby calibration, so no FCAL is needed (unless lock
+    // doesn't come back, then it recalibrates). returns wake-to-lock time in us, or -1
+    int wake(uint32_t timeout_us, bool* recalibrated);
     void enable_rf1(bool enabled);
     void enable_rf2(bool enabled);
-};
\ No newline at end of file
+    bool rf1_enabled() { return !config_fields.OUTA_PD_1b; }
+    bool rf2_enabled() { return !config_fields.OUTB_PD_1b; }
+
+    // group operations. registers that are identical on every device go out as one frame with all
+    // of the CS lines asserted together, and the FCAL is kicked off on all devices in the same frame
+    // also numbers the devices by their position in devs, for log records
+    static void init_all(LMX2592* const* devs, int count);
+    static void broadcast_write_all(LMX2592* const* devs, int count);
+    static void broadcast_fcal(LMX2592* const* devs, int count);
+    static bool broadcast_frequency(LMX2592* const* devs, int count, double freq_hz);
+};
+
+#include "lmx2592_regs.h"
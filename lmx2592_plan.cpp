@@ -0,0 +1,193 @@
+#include "lmx2592_plan.h"
+
+void LMX2592PlanTable::clear() {
+    count = 0;
+    pool_used = 0;
+}
+
+void LMX2592PlanTable::begin(LMX2592& dev) {
+    begin(dev.get_regfile());
+}
+
+void LMX2592PlanTable::begin(const uint16_t* base_image) {
+    clear();
+    for (int i = 0; i < 71; i++) base[i] = base_image[i];
+}
+
+int LMX2592PlanTable::encode(const uint16_t* base_image, const uint16_t* image, uint16_t* record) {
+    uint16_t mask = 0;
+    int len = 1;
+    for (int r = 0; r < NUM_PLAN_REGS; r++) {
+        uint8_t address = PLAN_REGS[r];
+        if (image[address] != base_image[address]) {
+            mask |= 1 << r;
+            record[len++] = image[address];
+        }
+    }
+    record[0] = mask;
+    return len;
+}
+
+int LMX2592PlanTable::record_words(uint16_t mask) {
+    int len = 1;
+    for (int r = 0; r < NUM_PLAN_REGS; r++) {
+        if (mask & (1 << r)) len++;
+    }
+    return len;
+}
+
+int LMX2592PlanTable::add_image(const uint16_t* image) {
+    uint16_t record[1 + NUM_PLAN_REGS];
+    encode(base, image, record);
+    return add_record(record);
+}
+
+int LMX2592PlanTable::add_record(const uint16_t* record) {
+    int len = record_words(record[0]);
+    if (count >= MAX_PLANS || pool_used + len > POOL_WORDS) return -1;
+
+    offsets[count] = pool_used;
+    for (int w = 0; w < len; w++) pool[pool_used++] = record[w];
+    return count++;
+}
+
+int LMX2592PlanTable::add_frequency(LMX2592& dev, double freq_hz) {
+    uint16_t image[71];
+    if (!dev.plan_image(freq_hz, image)) return -1;
+    return add_image(image);
+}
+
+uint16_t LMX_HOT(LMX2592PlanTable::merge_device_bits)(uint8_t address, uint16_t value, const uint16_t* regfile) {
+    switch (address) {
+        // output power-down and power are whatever the device is set to now, not what they were at plan time
+        case 46: return (value & ~0x3fc0) | (regfile[46] & 0x3fc0);
+        case 47: return (value & ~0x003f) | (regfile[47] & 0x003f);
+        // only FCAL_LPFD_ADJ / FCAL_HPFD_ADJ belong to the plan
+        case 0: return (value & 0x01e0) | (regfile[0] & ~0x01e0);
+        // VCO_CAPCTRL_OVR, VCO_IDAC_OVR: a new VCO frequency needs a real calibration, like plan_frequency()
+        case 8: return value & ~0x2400;
+        default: return value;
+    }
+}
+
+bool LMX_HOT(LMX2592PlanTable::apply)(int index, LMX2592& dev) {
+    if (index < 0 || index >= count) return false;
+    const uint16_t* plan = &pool[offsets[index]];
+    uint16_t mask = *plan++;
+
+    const uint16_t* regfile = dev.get_regfile();
+    uint16_t values[NUM_APPLY_REGS];
+    int r = 0;
+    for (int k = 0; k < NUM_APPLY_REGS; k++) {
+        uint8_t address = APPLY_REGS[k];
+        uint16_t value = base[address];
+        if (r < NUM_PLAN_REGS && PLAN_REGS[r] == address) {
+            if (mask & (1 << r)) value = *plan++;
+            r++;
+        }
+        values[k] = merge_device_bits(address, value, regfile);
+    }
+    dev.apply_registers(APPLY_REGS, values, NUM_APPLY_REGS);
+    return true;
+}
+
+int LMX2592PlanTable::plan_bytes(int index) {
+    if (index < 0 || index >= count) return 0;
+    int end = (index + 1 < count) ? offsets[index + 1] : pool_used;
+    // the pool words plus the plan's offset entry
+    return (end - offsets[index]) * (int) sizeof(uint16_t) + (int) sizeof(offsets[0]);
+}
+
+int LMX2592PlanTable::total_bytes() {
+    return pool_used * (int) sizeof(uint16_t) + count * (int) sizeof(offsets[0]) + (int) sizeof(base);
+}
+
+uint32_t LMX2592PlanLoader::crc32(uint32_t crc, const uint8_t* data, int len) {
+    // the usual reflected 0xEDB88320 one, bit at a time. uploads are limited by USB, not this
+    crc = ~crc;
+    for (int i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+void LMX2592PlanLoader::begin(LMX2592PlanTable* table) {
+    this->table = table;
+    state = LOAD_MORE;
+    position = 0;
+    plans = 0;
+    pool_words = 0;
+    words_done = 0;
+    crc = 0;
+    crc_received = 0;
+    record_len = 0;
+    record_need = 0;
+    table->clear();
+}
+
+LMX2592PlanLoader::status LMX2592PlanLoader::take_word(uint16_t value) {
+    if (words_done < 71) {
+        table->base[words_done++] = value;
+        return LOAD_MORE;
+    }
+    if (record_len == 0)
+        record_need = LMX2592PlanTable::record_words(value);
+    record[record_len++] = value;
+    words_done++;
+    if (record_len == record_need) {
+        if (table->add_record(record) < 0) return LOAD_TOO_BIG;
+        record_len = 0;
+    }
+    // a record can't run past the end of the pool
+    if (words_done == 71 + pool_words && record_len != 0) return LOAD_BAD_RECORD;
+    return LOAD_MORE;
+}
+
+LMX2592PlanLoader::status LMX2592PlanLoader::feed(const uint8_t* data, int len) {
+    const int header_len = HEADER_BYTES + LMX2592PlanTable::NUM_PLAN_REGS;
+    for (int i = 0; i < len && state == LOAD_MORE; i++) {
+        uint8_t byte = data[i];
+        int body_end = header_len + 2 * (71 + (int) pool_words);
+        if (position < body_end)
+            crc = crc32(crc, &byte, 1);
+
+        if (position < header_len) {
+            header[position] = byte;
+            if (position == header_len - 1) {
+                plans = header[8] | (header[9] << 8) | (header[10] << 16) | ((uint32_t) header[11] << 24);
+                pool_words = header[12] | (header[13] << 8) | (header[14] << 16) | ((uint32_t) header[15] << 24);
+                uint16_t version = header[4] | (header[5] << 8);
+                uint16_t num_regs = header[6] | (header[7] << 8);
+                bool ok = header[0] == 'L' && header[1] == 'M' && header[2] == 'X' && header[3] == 'P' &&
+                    version == VERSION && num_regs == LMX2592PlanTable::NUM_PLAN_REGS;
+                for (int r = 0; ok && r < LMX2592PlanTable::NUM_PLAN_REGS; r++)
+                    ok = header[HEADER_BYTES + r] == LMX2592PlanTable::PLAN_REGS[r];
+                if (!ok) state = LOAD_BAD_HEADER;
+                else if (plans > LMX2592PlanTable::MAX_PLANS || pool_words > LMX2592PlanTable::POOL_WORDS)
+                    state = LOAD_TOO_BIG;
+            }
+        }
+        else if (position < body_end) {
+            if ((position - header_len) % 2 == 0) {
+                word = byte;
+            }
+            else {
+                state = take_word(word | (byte << 8));
+            }
+        }
+        else {
+            crc_received |= (uint32_t) byte << (8 * (position - body_end));
+            if (position == body_end + 3) {
+                if (crc_received != crc) state = LOAD_BAD_CRC;
+                else if ((uint32_t) table->count != plans) state = LOAD_BAD_RECORD;
+                else state = LOAD_DONE;
+            }
+        }
+        position++;
+    }
+    if (state != LOAD_MORE && state != LOAD_DONE)
+        table->clear();
+    return state;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "pico/stdlib.h"
+#include "lmx2592.h"
+
+// compact storage for large numbers of precomputed operating points (hop plans). all plans share one base register
+// image, and each plan only keeps the registers that differ from it, out of the few a frequency plan can change:
+//
+//   [mask][value][value]...   one uint16_t mask bit per entry of PLAN_REGS, then the differing values in that order
+//
+// a plan expands straight into SPI frames, without going back through lmx2592_fields or the planner
+class LMX2592PlanTable {
+public:
+    static constexpr int NUM_PLAN_REGS = 16;
+    // everything plan_frequency() and the calibration profiles can touch, apart from R0 (FCAL is done on apply)
+    // and R14 (fast-lock handles that). highest address first, the order they are written in
+    static constexpr uint8_t PLAN_REGS[NUM_PLAN_REGS] = {64, 48, 47, 46, 45, 44, 38, 37, 36, 35, 34, 31, 30, 23, 11, 1};
+    // what goes out on apply: the plan registers, plus the ones every plan sets the same way and so takes from the
+    // base image (R41/R40 PLL_DEN, R10 MULT, R8 wake overrides off, R0 FCAL_HPFD_ADJ). the device may not hold those
+    // after an import or a wake. highest address first
+    static constexpr int NUM_APPLY_REGS = NUM_PLAN_REGS + 5;
+    static constexpr uint8_t APPLY_REGS[NUM_APPLY_REGS] = {
+        64, 48, 47, 46, 45, 44, 41, 40, 38, 37, 36, 35, 34, 31, 30, 23, 11, 10, 8, 1, 0};
+    static constexpr int MAX_PLANS = 4096;
+    static constexpr int POOL_WORDS = 24576;
+    // what the driver spends on one full operating point: the fields, the register file and write flags
+    static constexpr int FULL_PLAN_BYTES = sizeof(lmx2592_fields) + sizeof(uint16_t) * 71 + sizeof(bool) * 71;
+
+    uint16_t base[71];
+    int count = 0;
+    int pool_used = 0; // in words
+
+    void clear();
+    // takes the base image from the device's current state. clears the table
+    void begin(LMX2592& dev);
+    void begin(const uint16_t* base_image);
+    // encodes image against base into record, returns its length in words
+    static int encode(const uint16_t* base_image, const uint16_t* image, uint16_t* record);
+    static int record_words(uint16_t mask);
+    // encodes a full register image as the next plan, returns its index or -1 when full
+    int add_image(const uint16_t* image);
+    // appends an already encoded record, returns its index or -1 when full
+    int add_record(const uint16_t* record);
+    // plans freq_hz on dev (without touching the device) and adds it, returns its index or -1
+    int add_frequency(LMX2592& dev, double freq_hz);
+    // expands plan index into frames for dev and calibrates
+    bool apply(int index, LMX2592& dev);
+    // a planned value for one of APPLY_REGS, with what stays with the device merged in from its regfile: output
+    // enables and power, and everything in R0 but the FCAL comparator settings. wake overrides are cleared
+    static uint16_t merge_device_bits(uint8_t address, uint16_t value, const uint16_t* regfile);
+    int plan_bytes(int index);
+    int total_bytes();
+
+private:
+    uint16_t pool[POOL_WORDS];
+    uint16_t offsets[MAX_PLANS]; // where each plan starts in the pool
+};
+
+// binary plan table, as written by tools/plan_compiler and taken by -plan upload. all little endian
+//
+//   "LMXP", uint16_t version, uint16_t NUM_PLAN_REGS, uint32_t plans, uint32_t pool words   header
+//   uint8_t PLAN_REGS[NUM_PLAN_REGS]                                                        must match ours
+//   uint16_t base[71]
+//   uint16_t records[pool words]                                                            back to back
+//   uint32_t CRC-32 of everything above
+//
+// the loader takes it in pieces of any size as they come off USB, straight into a table
+class LMX2592PlanLoader {
+public:
+    static constexpr uint16_t VERSION = 1;
+    static constexpr int HEADER_BYTES = 16;
+
+    enum status {
+        LOAD_MORE,       // keep feeding
+        LOAD_DONE,
+        LOAD_BAD_HEADER, // wrong magic, version or register list
+        LOAD_TOO_BIG,    // doesn't fit in the table
+        LOAD_BAD_RECORD, // record runs past the pool, or the plan count doesn't match
+        LOAD_BAD_CRC,
+    };
+
+    void begin(LMX2592PlanTable* table);
+    status feed(const uint8_t* data, int len);
+    int received() { return position; }
+
+    static uint32_t crc32(uint32_t crc, const uint8_t* data, int len);
+
+private:
+    LMX2592PlanTable* table;
+    status state;
+    int position;          // bytes taken so far
+    uint8_t header[HEADER_BYTES + LMX2592PlanTable::NUM_PLAN_REGS];
+    uint32_t plans;
+    uint32_t pool_words;
+    uint32_t words_done;   // base and pool words taken
+    uint32_t crc;
+    uint32_t crc_received;
+    uint16_t word;         // low byte while waiting for the high one
+    uint16_t record[1 + LMX2592PlanTable::NUM_PLAN_REGS];
+    int record_len;
+    int record_need;
+
+    status take_word(uint16_t value);
+};
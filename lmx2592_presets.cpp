@@ -0,0 +1,48 @@
+#include "lmx2592_presets.h"
+
+// all of this is worked out by the compiler, the planner doesn't run for any of it on the device
+constexpr lmx2592_preset lmx2592_presets[] = {LMX_PRESET_LIST};
+constexpr int NUM_LMX2592_PRESETS = sizeof(lmx2592_presets) / sizeof(lmx2592_presets[0]);
+constexpr lmx2592_preset lmx2592_boot_preset = LMX_BOOT_MHZ;
+
+constexpr bool presets_in_range() {
+    for (int i = 0; i < NUM_LMX2592_PRESETS; i++) {
+        if (lmx2592_presets[i].freq_hz == 0) return false;
+    }
+    return true;
+}
+
+static_assert(presets_in_range(), "LMX_PRESETS_MHZ: a preset is outside what the LMX2592 can put out");
+static_assert(lmx2592_boot_preset.freq_hz != 0, "LMX_BOOT_MHZ: outside what the LMX2592 can put out");
+
+// bits that come from dev's calibration profile rather than the preset
+static constexpr uint16_t profile_bits(uint8_t address) {
+    switch (address) {
+        case 1: return 0x0007;  // CAL_CLK_DIV
+        case 23: return 0x7800; // VCO_SEL, FCAL_VCO_SEL_STRT
+        case 64: return 0x03ef; // FJUMP_SIZE, AJUMP_SIZE, FCAL_FAST, ACAL_FAST
+        default: return 0;
+    }
+}
+
+bool LMX_HOT(lmx2592_apply_preset)(const lmx2592_preset& preset, LMX2592& dev) {
+    if (preset.freq_hz == 0) return false;
+    // the profile for the preset's VCO frequency, the way plan_frequency() would set it (a seeded start core
+    // depends on the frequency)
+    lmx2592_fields fields = dev.config_fields;
+    dev.apply_cal_profile(fields, preset.vco_hz);
+    uint16_t profile[71] = {};
+    bool write_detect[71] = {};
+    LMX2592::pack_fields(fields, profile, write_detect);
+
+    const uint16_t* regfile = dev.get_regfile();
+    uint16_t values[LMX2592PlanTable::NUM_APPLY_REGS];
+    for (int r = 0; r < LMX2592PlanTable::NUM_APPLY_REGS; r++) {
+        uint8_t address = LMX2592PlanTable::APPLY_REGS[r];
+        uint16_t keep = profile_bits(address);
+        uint16_t value = (preset.values[r] & ~keep) | (profile[address] & keep);
+        values[r] = LMX2592PlanTable::merge_device_bits(address, value, regfile);
+    }
+    dev.apply_registers(LMX2592PlanTable::APPLY_REGS, values, LMX2592PlanTable::NUM_APPLY_REGS);
+    return true;
+}
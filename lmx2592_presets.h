@@ -0,0 +1,61 @@
+#pragma once
+#include "pico/stdlib.h"
+#include "lmx2592.h"
+#include "lmx2592_plan.h"
+
+// fixed operating points, planned and packed by the compiler and kept in flash as finished register values. switching
+// to one is a bus write and a calibration, nothing gets planned on the device
+//
+// the list is set at build time (LMX_PRESETS_MHZ and LMX_BOOT_MHZ in CMakeLists.txt)
+#ifndef LMX_PRESET_LIST
+#define LMX_PRESET_LIST 1100, 2400, 5800
+#endif
+#ifndef LMX_BOOT_MHZ
+#define LMX_BOOT_MHZ 1100
+#endif
+
+struct lmx2592_preset {
+    double freq_hz = 0; // 0 when the frequency couldn't be planned
+    double vco_hz = 0;  // the device's calibration profile is worked out for this on apply
+    // LMX2592PlanTable::APPLY_REGS of the planned image, in that order. the preset has to take a device from its
+    // reset defaults, so it covers the registers a hop plan leaves to its base image too. planned from the driver
+    // defaults with CAL_DEFAULT
+    uint16_t values[LMX2592PlanTable::NUM_APPLY_REGS] = {};
+
+    // not explicit, so a preset table can be written as a plain list of frequencies
+    constexpr lmx2592_preset(double freq_mhz) {
+        lmx2592_fields fields{};
+        LMX2592::default_fields(fields);
+        double vco_freq = 0;
+        if (!LMX2592::plan_fields(fields, freq_mhz * 1'000'000.0, vco_freq)) return;
+        // what plan_frequency() does on top with the default calibration profile and no fast-lock
+        fields.VCO_SEL_FORCE_1b = 0;
+        fields.VCO_CAPCTRL_OVR_1b = 0;
+        fields.VCO_IDAC_OVR_1b = 0;
+        fields.CAL_CLK_DIV_3b = 3;
+        fields.FJUMP_SIZE_4b = 15;
+        fields.AJUMP_SIZE_3b = 3;
+        fields.FCAL_FAST_1b = 0;
+        fields.ACAL_FAST_1b = 0;
+        fields.FCAL_VCO_SEL_STRT_1b = 0;
+        fields.VCO_SEL_3b = 1;
+        fields.FCAL_EN_1b = 0;
+
+        uint16_t regfile[71] = {};
+        bool write_detect[71] = {};
+        LMX2592::pack_fields(fields, regfile, write_detect);
+        for (int r = 0; r < LMX2592PlanTable::NUM_APPLY_REGS; r++)
+            values[r] = regfile[LMX2592PlanTable::APPLY_REGS[r]];
+        freq_hz = freq_mhz * 1'000'000.0;
+        vco_hz = vco_freq;
+    }
+};
+
+extern const lmx2592_preset lmx2592_presets[];
+extern const int NUM_LMX2592_PRESETS;
+extern const lmx2592_preset lmx2592_boot_preset;
+
+// writes the preset's registers that differ from dev's and calibrates. the output enables and power stay as they are,
+// and the calibration settings are dev's profile for the preset's VCO frequency. wake overrides are cleared. the rest
+// of those registers comes from the driver defaults, so a configuration imported over them is replaced
+bool lmx2592_apply_preset(const lmx2592_preset& preset, LMX2592& dev);
@@ -0,0 +1,555 @@
+#pragma once
+// included at the end of lmx2592.h: the static planning and register packing functions of LMX2592. they're constexpr,
+// so fixed operating points can be planned and packed by the compiler (lmx2592_presets.h), and they're the same code
+// the driver runs when it plans at run time
+
+[[gnu::always_inline]] constexpr void LMX2592::pack_fields(const lmx2592_fields& f, uint16_t* regfile, bool* write_detect) {
+    for (int i = 0; i < 71; i++) {
+        regfile[i] = 0;
+        write_detect[i] = false;
+    }
+    // R0
+    regfile[0] = 0b0000001000000000;
+    regfile[0] |= ((f.POWERDOWN_1b & 0x1) << 0);
+    regfile[0] |= ((f.RESET_1b & 0x1) << 1);
+    regfile[0] |= ((f.MUXOUT_SEL_1b & 0x1) << 2);
+    regfile[0] |= ((f.FCAL_EN_1b & 0x1) << 3);
+    regfile[0] |= ((f.ACAL_EN_1b & 0x1) << 4);
+    regfile[0] |= ((f.FCAL_LPFD_ADJ_2b & 0x3) << 5);
+    regfile[0] |= ((f.FCAL_HPFD_ADJ_2b & 0x3) << 7);
+    regfile[0] |= ((f.LD_EN_1b & 0x1) << 13);
+
+    // R1
+    regfile[1] = 0b0000100000001000;
+    regfile[1] |= ((f.CAL_CLK_DIV_3b & 0x7) << 0);
+
+    // R2
+    regfile[2] = 0b0000010100000000;
+
+    // R4
+    regfile[4] = 0b0000000001000011;
+    regfile[4] |= ((f.ACAL_CMP_DLY_8b & 0xff) << 8);
+
+    // R7
+    regfile[7] = 0b0010100010110010;
+
+    // R8
+    regfile[8] = 0b0001000010000100;
+    regfile[8] |= ((f.VCO_CAPCTRL_OVR_1b & 0x1) << 10);
+    regfile[8] |= ((f.VCO_IDAC_OVR_1b & 0x1) << 13);
+
+    // R9
+    regfile[9] = 0b0000000100000010;
+    regfile[9] |= ((f.REF_EN_1b & 0x1) << 9);
+    regfile[9] |= ((f.OSC_2X_1b & 0x1) << 11);
+
+    // R10
+    regfile[10] = 0b0001000001011000;
+    regfile[10] |= ((f.MULT_5b & 0x1f) << 7);
+
+    // R11
+    regfile[11] = 0b0000000000001000;
+    regfile[11] |= ((f.PLL_R_8b & 0xff) << 4);
+
+    // R12
+    regfile[12] = 0b0111000000000000;
+    regfile[12] |= ((f.PLL_R_PRE_12b & 0xfff) << 0);
+
+    // R13
+    regfile[13] = 0b0000000000000000;
+    regfile[13] |= ((f.PFD_CTL_2b & 0x3) << 0);
+    regfile[13] |= ((f.CP_EN_1b & 0x1) << 14);
+
+    // R14
+    regfile[14] = 0b0000000000000000;
+    regfile[14] |= ((f.CP_ICOARSE_2b & 0x3) << 0);
+    regfile[14] |= ((f.CP_IUP_5b & 0x1f) << 2);
+    regfile[14] |= ((f.CP_IDN_5b & 0x1f) << 7);
+
+    // R19
+    regfile[19] = 0b0000000000000101;
+    regfile[19] |= ((f.VCO_IDAC_9b & 0x1ff) << 3);
+
+    // R20
+    regfile[20] = 0b0000000000000000;
+    regfile[20] |= ((f.ACAL_VCO_IDAC_STRT_9b & 0x1ff) << 0);
+
+    // R22
+    regfile[22] = 0b0010001100000000;
+    regfile[22] |= ((f.VCO_CAPCTRL_8b & 0xff) << 0);
+
+    // R23
+    regfile[23] = 0b1000000001000010;
+    regfile[23] |= ((f.VCO_SEL_FORCE_1b & 0x1) << 10);
+    regfile[23] |= ((f.VCO_SEL_3b & 0x7) << 11);
+    regfile[23] |= ((f.FCAL_VCO_SEL_STRT_1b & 0x1) << 14);
+
+    // R24
+    regfile[24] = 0b0000010100001001;
+
+    // R25
+    regfile[25] = 0b0000000000000000;
+
+    // R28
+    regfile[28] = 0b0010100100100100;
+
+    // R29
+    regfile[29] = 0b0000000010000100;
+
+    // R30
+    regfile[30] = 0b0000000000110100;
+    regfile[30] |= ((f.VCO_2X_EN_1b & 0x1) << 0);
+    regfile[30] |= ((f.VTUNE_ADJ_2b & 0x3) << 6);
+    regfile[30] |= ((f.MASH_DITHER_1b & 0x1) << 10);
+
+    // R31
+    regfile[31] = 0b0000000000000001;
+    regfile[31] |= ((f.CHDIV_DIST_PD_1b & 0x1) << 7);
+    regfile[31] |= ((f.VCO_DISTA_PD_1b & 0x1) << 9);
+    regfile[31] |= ((f.VCO_DISTB_PD_1b & 0x1) << 10);
+
+    // R32
+    regfile[32] = 0b0010000100001010;
+
+    // R33
+    regfile[33] = 0b0010101000001010;
+
+    // R34
+    regfile[34] = 0b1100001111001010;
+    regfile[34] |= ((f.CHDIV_EN_1b & 0x1) << 5);
+
+    // R35
+    regfile[35] = 0b0000000000011001;
+    regfile[35] |= ((f.CHDIV_SEG1_EN_1b & 0x1) << 1);
+    regfile[35] |= ((f.CHDIV_SEG1_1b & 0x1) << 2);
+    regfile[35] |= ((f.CHDIV_SEG2_EN_1b & 0x1) << 7);
+    regfile[35] |= ((f.CHDIV_SEG3_EN_1b & 0x1) << 8);
+    regfile[35] |= ((f.CHDIV_SEG2_4b & 0xf) << 9);
+
+    // R36
+    regfile[36] = 0b0000000000000000;
+    regfile[36] |= ((f.CHDIV_SEG3_3b & 0xf) << 0);
+    regfile[36] |= ((f.CHDIV_SEG_SEL_4b & 0x7) << 4);
+    regfile[36] |= ((f.CHDIV_DISTA_EN_1b & 0x1) << 10);
+    regfile[36] |= ((f.CHDIV_DISTB_EN_1b & 0x1) << 11);
+
+    // R37
+    regfile[37] = 0b0100000000000000;
+    regfile[37] |= ((f.PLL_N_PRE_1b & 0x1) << 12);
+
+    // R38
+    regfile[38] = 0b0000000000000000;
+    regfile[38] |= ((f.PLL_N_12b & 0xfff) << 1);
+
+    // R39
+    regfile[39] = 0b1000000000000100;
+    regfile[39] |= ((f.PFD_DLY_6b & 0x3f) << 8);
+
+    // R40
+    regfile[40] = 0b0000000000000000;
+    regfile[40] |= ((f.PLL_DEN_31_16__16b & 0xffff) << 0);
+
+    // R41
+    regfile[41] = 0b0000000000000000;
+    regfile[41] |= ((f.PLL_DEN_15_0__16b & 0xffff) << 0);
+
+    // R42
+    regfile[42] = 0b0000000000000000;
+    regfile[42] |= ((f.MASH_SEED_31_16__16b & 0xffff) << 0);
+
+    // R43
+    regfile[43] = 0b0000000000000000;
+    regfile[43] |= ((f.MASH_SEED_15_0__16b & 0xffff) << 0);
+
+    // R44
+    regfile[44] = 0b0000000000000000;
+    regfile[44] |= ((f.PLL_NUM_31_16__16b & 0xffff) << 0);
+
+    // R45
+    regfile[45] = 0b0000000000000000;
+    regfile[45] |= ((f.PLL_NUM_15_0__16b & 0xffff) << 0);
+
+    // R46
+    regfile[46] = 0b0000000000100000;
+    regfile[46] |= ((f.MASH_ORDER_3b & 0x7) << 0);
+    regfile[46] |= ((f.OUTA_PD_1b & 0x1) << 6);
+    regfile[46] |= ((f.OUTB_PD_1b & 0x1) << 7);
+    regfile[46] |= ((f.OUTA_POW_6b & 0x3f) << 8);
+
+    // R47
+    regfile[47] = 0b0000000011000000;
+    regfile[47] |= ((f.OUTB_POW_6b & 0x3f) << 0);
+    regfile[47] |= ((f.OUTA_MUX_2b & 0x3) << 11);
+
+    // R48
+    regfile[48] = 0b0000001111111100;
+    regfile[48] |= ((f.OUTB_MUX_2b & 0x3) << 0);
+
+    // R59
+    regfile[59] = 0b0000000000000000;
+    regfile[59] |= ((f.MUXOUT_HDRV_1b & 0x1) << 5);
+
+    // R61
+    regfile[61] = 0b0000000000000000;
+    regfile[61] |= ((f.LD_TYPE_1b & 0x1) << 0);
+
+    // R62
+    regfile[62] = 0b0000000000000000;
+
+    // R64
+    regfile[64] = 0b0000000000010000;
+    regfile[64] |= ((f.FJUMP_SIZE_4b & 0xf) << 0);
+    regfile[64] |= ((f.AJUMP_SIZE_3b & 0x7) << 5);
+    regfile[64] |= ((f.FCAL_FAST_1b & 0x1) << 8);
+    regfile[64] |= ((f.ACAL_FAST_1b & 0x1) << 9);
+
+    // R68
+    regfile[68] = 0b0000000000000000;
+    regfile[68] |= ((f.rb_VCO_SEL_3b & 0x7) << 5);
+    regfile[68] |= ((f.rb_LD_VTUNE_2b & 0x3) << 9);
+
+    // R69
+    regfile[69] = 0b0000000000000000;
+    regfile[69] |= ((f.rb_VCO_CAPCTRL_8b & 0xff) << 0);
+
+    // R70
+    regfile[70] = 0b0000000000000000;
+    regfile[70] |= ((f.rb_VCO_DACISET_9b & 0x1ff) << 0);
+
+    // mark the ones to be written
+    write_detect[0] = true;
+    write_detect[1] = true;
+    write_detect[2] = true;
+    write_detect[4] = true;
+    write_detect[7] = true;
+    write_detect[8] = true;
+    write_detect[9] = true;
+    write_detect[10] = true;
+    write_detect[11] = true;
+    write_detect[12] = true;
+    write_detect[13] = true;
+    write_detect[14] = true;
+    write_detect[19] = true;
+    write_detect[20] = true;
+    write_detect[22] = true;
+    write_detect[23] = true;
+    write_detect[24] = true;
+    write_detect[25] = true;
+    write_detect[28] = true;
+    write_detect[29] = true;
+    write_detect[30] = true;
+    write_detect[31] = true;
+    write_detect[32] = true;
+    write_detect[33] = true;
+    write_detect[34] = true;
+    write_detect[35] = true;
+    write_detect[36] = true;
+    write_detect[37] = true;
+    write_detect[38] = true;
+    write_detect[39] = true;
+    write_detect[40] = true;
+    write_detect[41] = true;
+    write_detect[42] = true;
+    write_detect[43] = true;
+    write_detect[44] = true;
+    write_detect[45] = true;
+    write_detect[46] = true;
+    write_detect[47] = true;
+    write_detect[48] = true;
+    write_detect[59] = true;
+    write_detect[61] = true;
+    write_detect[62] = true;
+    write_detect[64] = true;
+}
+
+constexpr void LMX2592::default_fields(lmx2592_fields& f) {
+    // R0
+    f.POWERDOWN_1b = 0;
+    f.RESET_1b = 0;
+    f.MUXOUT_SEL_1b = 1;
+    f.FCAL_EN_1b = 0; // this is not default but we want to do this last.
+    f.ACAL_EN_1b = 1;
+    f.FCAL_LPFD_ADJ_2b = 0;
+    f.FCAL_HPFD_ADJ_2b = 0;
+    f.LD_EN_1b = 1;
+    // R1
+    f.CAL_CLK_DIV_3b = 3;
+    // R2
+    // R4
+    f.ACAL_CMP_DLY_8b = 25;
+    // R7
+    // R8
+    f.VCO_CAPCTRL_OVR_1b = 0;
+    f.VCO_IDAC_OVR_1b = 0;
+    // R9
+    f.REF_EN_1b = 1;
+    f.OSC_2X_1b = 0;
+    // R10
+    f.MULT_5b = 1;
+    // R11
+    f.PLL_R_8b = 1;
+    // R12
+    f.PLL_R_PRE_12b = 1;
+    // R13
+    f.PFD_CTL_2b = 0;
+    f.CP_EN_1b = 1;
+    // R14
+    f.CP_ICOARSE_2b = 1;
+    f.CP_IUP_5b = 3;
+    f.CP_IDN_5b = 3;
+    // R19
+    f.VCO_IDAC_9b = 300;
+    // R20
+    f.ACAL_VCO_IDAC_STRT_9b = 300;
+    // R22
+    f.VCO_CAPCTRL_8b = 0;
+    // R23
+    f.VCO_SEL_FORCE_1b = 0;
+    f.VCO_SEL_3b = 1;
+    f.FCAL_VCO_SEL_STRT_1b = 0;
+    // R24
+    // R25
+    // R28
+    // R29
+    // R30
+    f.VCO_2X_EN_1b = 0;
+    f.VTUNE_ADJ_2b = 0; // Change this register field according to the VCO frequency, 0: fVCO < 6500 MHz, 3: fVCO ≥ 6500 MHz
+    f.MASH_DITHER_1b = 0;
+    // R31
+    f.CHDIV_DIST_PD_1b = 0;
+    f.VCO_DISTA_PD_1b = 0;
+    f.VCO_DISTB_PD_1b = 1;
+    // R32
+    // R33
+    // R34
+    f.CHDIV_EN_1b = 1;
+    // R35
+    f.CHDIV_SEG1_EN_1b = 0;
+    f.CHDIV_SEG1_1b = 1;
+    f.CHDIV_SEG2_EN_1b = 0;
+    f.CHDIV_SEG3_EN_1b = 0;
+    f.CHDIV_SEG2_4b = 1;
+    // R36
+    f.CHDIV_SEG3_3b = 1;
+    f.CHDIV_SEG_SEL_4b = 1;
+    f.CHDIV_DISTA_EN_1b = 1;
+    f.CHDIV_DISTB_EN_1b = 0;
+    // R37
+    f.PLL_N_PRE_1b = 0;
+    // R38
+    f.PLL_N_12b = 27;
+    // R39
+    f.PFD_DLY_6b = 2;
+    // R40
+    f.PLL_DEN_31_16__16b = 1000;
+    // R41
+    f.PLL_DEN_15_0__16b = 1000;
+    // R42
+    f.MASH_SEED_31_16__16b = 0;
+    // R43
+    f.MASH_SEED_15_0__16b = 0;
+    // R44
+    f.PLL_NUM_31_16__16b = 0;
+    // R45
+    f.PLL_NUM_15_0__16b = 0;
+    // R46
+    f.MASH_ORDER_3b = 3;
+    f.OUTA_PD_1b = 0;
+    f.OUTB_PD_1b = 1;
+    f.OUTA_POW_6b = 15;
+    // R47
+    f.OUTB_POW_6b = 0;
+    f.OUTA_MUX_2b = 0;
+    // R48
+    f.OUTB_MUX_2b = 0;
+    // R59
+    f.MUXOUT_HDRV_1b = 0;
+    // R61
+    f.LD_TYPE_1b = 1;
+    // R62
+    // R64
+    f.FJUMP_SIZE_4b = 15;
+    f.AJUMP_SIZE_3b = 3;
+    f.FCAL_FAST_1b = 0;
+    f.ACAL_FAST_1b = 0;
+    // R68
+    f.rb_VCO_SEL_3b = 0; // these ones are readback values!!
+    f.rb_LD_VTUNE_2b = 0; // these ones are readback values!!
+    // R69
+    f.rb_VCO_CAPCTRL_8b = 0; // these ones are readback values!!
+    // R70
+    f.rb_VCO_DACISET_9b = 0; // these ones are readback values!!
+}
+
+constexpr void LMX2592::divider_fields(lmx2592_fields& f, double divider) {
+    uint16_t N_divider = (int)divider;
+
+    double frac = divider - (double) N_divider;
+    double denom_f = (double) 0xffffffff; // maximum possible divider
+    double numer_f = frac * denom_f;
+
+    f.PLL_N_12b = N_divider;
+
+    f.PLL_DEN_15_0__16b = (uint16_t)(((uint32_t) denom_f) & 0xffff);
+    f.PLL_DEN_31_16__16b = (uint16_t)(((uint32_t) denom_f >> 16) & 0xffff);
+    
+    f.PLL_NUM_15_0__16b = (uint16_t)(((uint32_t) numer_f) & 0xffff);
+    f.PLL_NUM_31_16__16b = (uint16_t)(((uint32_t) numer_f >> 16) & 0xffff);
+
+    // handle MASH recommendations and stuff
+    // go for third order when possible
+    uint16_t mash_order = 3;
+    uint16_t pfd_delay = 2;
+    if (N_divider < 18) {
+        mash_order = 2;
+        pfd_delay = 2;
+    }  
+    if (N_divider < 16) {
+        mash_order = 1;
+        pfd_delay = 1;
+    }
+    // MASH order 0 is too shit so we dont use it
+    f.MASH_ORDER_3b = mash_order;
+}
+
+constexpr bool LMX2592::plan_fields(lmx2592_fields& f, double freq_hz, double& vco_freq) {
+    if (freq_hz < OUT_MIN_HZ || freq_hz > OUT_MAX_HZ) return false;
+    f.MULT_5b = 5;
+    f.PLL_R_8b = 2; // post R = 2
+    f.FCAL_HPFD_ADJ_2b = 1; // Fpfd = 100 - 150 MHz
+    f.PLL_N_PRE_1b = 0; // divide by two
+    double pfd_freq = 5 * REF_HZ / 2; // 120 MHz
+    double divider;
+    if (freq_hz < VCO_MIN_HZ) { // must use channel divider
+        double total_division = 0;
+        for (int row = 0; row < CHDIV_BANDS; row++) {
+            double min_freq = 1'000'000.0 * (double) chdiv_table[row][0];
+            double max_freq = 1'000'000.0 * (double) chdiv_table[row][1];
+            uint16_t seg1_val = chdiv_table[row][2];
+            uint16_t seg2_val = chdiv_table[row][3];
+            uint16_t seg3_val = chdiv_table[row][4];
+
+            uint16_t mux_val = chdiv_table[row][5];
+            
+            total_division = (double) chdiv_table[row][6];
+
+            if ((min_freq <= freq_hz) && (max_freq >= freq_hz)) {
+                // this one works
+                f.CHDIV_SEG1_1b = seg1_val;
+                f.CHDIV_SEG2_4b = seg2_val;
+                f.CHDIV_SEG3_3b = seg3_val;
+                f.CHDIV_SEG_SEL_4b = mux_val;
+
+                break;
+            }
+        }
+        if (total_division < 1.0)
+            return false; // valid range not found
+        vco_freq = total_division * freq_hz;
+        divider = vco_freq / (2 * pfd_freq); // 2 is from the prescaler
+
+        f.VCO_2X_EN_1b = 0;
+
+        // enable channel divider
+        f.CHDIV_EN_1b = 1;
+        f.CHDIV_DIST_PD_1b = 0;
+        f.CHDIV_SEG1_EN_1b = 1;
+        f.CHDIV_SEG2_EN_1b = 1;
+        f.CHDIV_SEG3_EN_1b = 1;
+        f.CHDIV_DISTA_EN_1b = 1;
+        f.CHDIV_DISTB_EN_1b = 1;
+        // power down the VCO dist
+        f.VCO_DISTA_PD_1b = 1;
+        f.VCO_DISTB_PD_1b = 1;
+        // select CHDIV mux
+        f.OUTA_MUX_2b = 0;
+        f.OUTB_MUX_2b = 0;
+        
+    }
+    else {
+        if (freq_hz < VCO_MAX_HZ) {
+            // can use fundamental
+            f.VCO_2X_EN_1b = 0;
+            vco_freq = freq_hz;
+            divider = freq_hz / (2 * pfd_freq); // 2 is from the prescaler
+        }
+        else {
+            // must use doubler
+            f.VCO_2X_EN_1b = 1; // enable vco doubler
+            f.PLL_N_PRE_1b = 1; // with doubler, must also set PLL N prescaler to 4
+            vco_freq = freq_hz / 2;
+            divider = freq_hz / (4 * pfd_freq); // 4 is from prescaler
+        }
+        // disable channel divider
+        f.CHDIV_EN_1b = 0;
+        f.CHDIV_DIST_PD_1b = 1;
+        f.CHDIV_SEG1_EN_1b = 0;
+        f.CHDIV_SEG2_EN_1b = 0;
+        f.CHDIV_SEG3_EN_1b = 0;
+        f.CHDIV_DISTA_EN_1b = 0;
+        f.CHDIV_DISTB_EN_1b = 0;
+        // segments back to their reset values, so the image doesn't depend on what was planned before
+        f.CHDIV_SEG1_1b = 1;
+        f.CHDIV_SEG2_4b = 1;
+        f.CHDIV_SEG3_3b = 1;
+        f.CHDIV_SEG_SEL_4b = 1;
+        // power up the VCO dist
+        f.VCO_DISTA_PD_1b = 0;
+        f.VCO_DISTB_PD_1b = 0;
+        // select VCO mux
+        f.OUTA_MUX_2b = 1;
+        f.OUTB_MUX_2b = 1;
+    }
+    
+
+    divider_fields(f, divider);
+    return true;
+}
+
+// compile-time checks on chdiv_table. plan_fields() takes the first band that fits, top down
+
+// CHDIV_SEG1 is 0 for /2, 1 for /3. SEG2 and SEG3 are one-hot: 1, 2, 4, 8 for /2, /4, /6, /8
+constexpr int chdiv_segment_division(uint16_t seg) {
+    return (seg == 1) ? 2 : (seg == 2) ? 4 : (seg == 4) ? 6 : (seg == 8) ? 8 : 0;
+}
+
+// the segments that the mux picks up multiply out to TOTAL_DIV
+constexpr bool chdiv_segments_match() {
+    for (int row = 0; row < LMX2592::CHDIV_BANDS; row++) {
+        const uint16_t* band = LMX2592::chdiv_table[row];
+        int division = band[2] ? 3 : 2;
+        if (band[5] >= 2) division *= chdiv_segment_division(band[3]);
+        if (band[5] >= 4) division *= chdiv_segment_division(band[4]);
+        if (band[5] != 1 && band[5] != 2 && band[5] != 4) return false;
+        if (division != band[6]) return false;
+    }
+    return true;
+}
+
+// from the bottom of the output range up to the VCO with no gaps, and each band starts below the one before it,
+// so none is completely shadowed
+constexpr bool chdiv_bands_cover_range() {
+    if (LMX2592::chdiv_table[0][1] * 1'000'000.0 < LMX2592::VCO_MIN_HZ) return false;
+    if (LMX2592::chdiv_table[LMX2592::CHDIV_BANDS - 1][0] * 1'000'000.0 > LMX2592::OUT_MIN_HZ) return false;
+    for (int row = 0; row < LMX2592::CHDIV_BANDS; row++) {
+        if (LMX2592::chdiv_table[row][0] >= LMX2592::chdiv_table[row][1]) return false;
+        if (row == 0) continue;
+        if (LMX2592::chdiv_table[row][0] >= LMX2592::chdiv_table[row - 1][0]) return false;
+        if (LMX2592::chdiv_table[row][1] < LMX2592::chdiv_table[row - 1][0]) return false;
+    }
+    return true;
+}
+
+// every frequency in a band puts the VCO inside its range
+constexpr bool chdiv_bands_reach_vco() {
+    for (int row = 0; row < LMX2592::CHDIV_BANDS; row++) {
+        const uint16_t* band = LMX2592::chdiv_table[row];
+        if (band[0] * 1'000'000.0 * band[6] < LMX2592::VCO_MIN_HZ) return false;
+        if (band[1] * 1'000'000.0 * band[6] > LMX2592::VCO_MAX_HZ) return false;
+    }
+    return true;
+}
+
+static_assert(chdiv_segments_match(), "chdiv_table: segment settings don't multiply out to TOTAL_DIV");
+static_assert(chdiv_bands_cover_range(), "chdiv_table: bands must run top down from the VCO to OUT_MIN_HZ without gaps");
+static_assert(chdiv_bands_reach_vco(), "chdiv_table: a band takes the VCO out of its range");
@@ -3,27 +3,534 @@
 #include "hardware/gpio.h"
 #include "hardware/spi.h"
 #include "pico/bootrom.h"
+#include "hardware/clocks.h"
 #include "string.h"
 #include <cstdlib>
+#include <cmath>
 
 #include "lmx2592.h"
+#include "board.h"
+#include "spi_trace.h"
+#include "ticspro_import.h"
+#include "event_log.h"
+#include "lmx2592_plan.h"
+#include "lmx2592_presets.h"
+#include "scpi.h"
+#include "usb_bulk.h"
+#include "scheduler.h"
+#include "tusb.h"
 
 /*
     In case of build issues after copying the template, delete the entire build directory and in VSCode:
     Restart VSCode, click on "Terminal" on the top bar, and select GCC 10.2.1 arm-none-eabi
 
-    Overclocking: https://youtu.be/G2BuoFNLoDM (The "catch" is already fixed in CMakeLists.txt, uncomment the three lines at the bottom)
+    Overclocking: https://youtu.be/G2BuoFNLoDM (The "catch" is already fixed in CMakeLists.txt, configure with -DLMX_PERFORMANCE_BUILD=ON)
     PIO: https://youtu.be/JSis2NU65w8
     Explaining PIO ASM instructions: https://youtu.be/yYnQYF_Xa8g
 
     - Max X, 2022-01-07
 */
 
-#define GPIO_RGB_B      25
-#define GPIO_RGB_G      16
-#define GPIO_RGB_R      17
+// one entry per synthesizer on the fixture. extra devices can share spi0 (SCK/MOSI/MUXOUT) with their own CS
+// and EN pins, or sit on spi1, e.g. {spi1, 10, 11, 12, 13, 14}
+LMX2592 plls[] = {
+    LMX2592(BOARD_LMX_PINS),
+};
+const int NUM_PLLS = count_of(plls);
+LMX2592* all_plls[NUM_PLLS];
 
-LMX2592 pll;
+uint32_t selected_plls = 1; // bitmask of the devices that commands go to, set with -dev
+
+LMX2592PlanTable plan_table; // hop plans built with -plan, shared by every device
+
+// index of a device in plls[], for log records
+int pll_index(LMX2592* dev) {
+    return (int) (dev - plls);
+}
+
+// frequency as two int32 log arguments: whole MHz and the Hz left over
+int32_t freq_mhz(double freq_hz) {
+    return (int32_t) (freq_hz / 1'000'000.0);
+}
+int32_t freq_hz_rem(double freq_hz) {
+    return (int32_t) (freq_hz - 1'000'000.0 * (double) freq_mhz(freq_hz));
+}
+
+// fills sel with the currently selected devices, returns how many there are
+int get_selected(LMX2592** sel) {
+    int count = 0;
+    for (int i = 0; i < NUM_PLLS; i++) {
+        if (selected_plls & (1u << i))
+            sel[count++] = &plls[i];
+    }
+    return count;
+}
+
+uint32_t bulk_streams = 0; // bit n set: records of type n (usb_bulk_record) are being streamed over the bulk interface
+
+// a record header on the bulk IN stream
+void bulk_record_header(uint8_t* record, usb_bulk_record type, int device, int payload_len) {
+    record[0] = type;
+    record[1] = (uint8_t) device;
+    record[2] = payload_len & 0xff;
+    record[3] = payload_len >> 8;
+}
+
+// streams one lock measurement, if lock telemetry is on
+void LMX_HOT(telemetry_lock)(LMX2592* dev, double freq_hz, int lock_time) {
+    if (!(bulk_streams & (1u << BULK_REC_LOCK))) return;
+    uint8_t* record = usb_bulk_tx_reserve(4 + 16);
+    if (!record) return;
+    bulk_record_header(record, BULK_REC_LOCK, pll_index(dev), 16);
+    uint32_t time = time_us_32();
+    int32_t lock = lock_time;
+    memcpy(record + 4, &time, 4);
+    memcpy(record + 8, &lock, 4);
+    memcpy(record + 12, &freq_hz, 8);
+    usb_bulk_tx_commit(4 + 16);
+    // sweeps don't pass through the idle loop, keep the records moving from here
+    usb_bulk_flush();
+}
+
+// retunes every device in sel and waits for all of them to lock. returns the slowest lock time, or -1
+int LMX_HOT(sweep_step)(LMX2592** sel, int count, double freq_hz) {
+    if (!LMX2592::broadcast_frequency(sel, count, freq_hz))
+        return -1;
+    int worst = 0;
+    for (int d = 0; d < count; d++) {
+        int lock_time = sel[d]->wait_for_lock(10000);
+        telemetry_lock(sel[d], freq_hz, lock_time);
+        if (lock_time < 0) {
+            log_event(LOG_WARN, EV_LOCK_TIMEOUT, pll_index(sel[d]));
+            return -1;
+        }
+        if (lock_time > worst)
+            worst = lock_time;
+    }
+    log_event(LOG_DEBUG, EV_SWEEP_STEP, freq_mhz(freq_hz), freq_hz_rem(freq_hz), worst);
+    return worst;
+}
+
+// the state the board comes up in: the boot preset (LMX_BOOT_MHZ, 1.1 GHz unless the build says otherwise), lowest
+// power, both outputs off, default calibration and no fast-lock
+void load_boot_state() {
+    for (int i = 0; i < NUM_PLLS; i++) {
+        plls[i].set_fastlock(false);
+        plls[i].set_cal_profile(CAL_DEFAULT);
+        lmx2592_apply_preset(lmx2592_boot_preset, plls[i]);
+        plls[i].wait_for_lock(10000); // so the next retune can tell whether the calibration still stands
+        plls[i].set_power_int(0);
+        plls[i].enable_rf1(0);
+        plls[i].enable_rf2(0);
+    }
+}
+
+ScpiQueue scpi;
+
+// runs the oldest queued SCPI command on the selected devices. settings don't wait for lock, *OPC? does
+void scpi_service() {
+    if (scpi.empty()) return;
+    scpi_command cmd = *scpi.front();
+    scpi.pop();
+
+    LMX2592* sel[NUM_PLLS];
+    int count = get_selected(sel);
+    if (count == 0) return;
+    // the reply goes out once the scheduler is let go again, printf can block on a full CDC buffer
+    char reply[96] = "";
+    sched_hold();
+    switch (cmd.id) {
+        case SCPI_FREQ:
+            if (cmd.query)
+                snprintf(reply, sizeof(reply), "%.3f\n", sel[0]->output_from_config());
+            else if (!LMX2592::broadcast_frequency(sel, count, cmd.value))
+                scpi.push_error(SCPI_ERR_DATA_OUT_OF_RANGE);
+            break;
+        case SCPI_POW:
+            if (cmd.query) {
+                snprintf(reply, sizeof(reply), "%d\n", (int) sel[0]->get_power_int());
+            }
+            else {
+                for (int d = 0; d < count; d++)
+                    sel[d]->set_power_int((uint16_t) cmd.value);
+            }
+            break;
+        case SCPI_OUTP:
+            if (cmd.query) {
+                snprintf(reply, sizeof(reply), "%d\n", (cmd.channel == 1) ? sel[0]->rf1_enabled() : sel[0]->rf2_enabled());
+            }
+            else {
+                for (int d = 0; d < count; d++) {
+                    if (cmd.channel == 1) sel[d]->enable_rf1(cmd.value != 0);
+                    else sel[d]->enable_rf2(cmd.value != 0);
+                }
+            }
+            break;
+        case SCPI_SYST_ERR: {
+            int code = scpi.pop_error();
+            snprintf(reply, sizeof(reply), "%d,\"%s\"\n", code, ScpiQueue::error_message(code));
+            break;
+        }
+        case SCPI_IDN:
+            snprintf(reply, sizeof(reply), "thaumatichthys,LMX2592 Test Board,0,%s\n", BUILD_PROFILE);
+            break;
+        case SCPI_RST:
+            load_boot_state();
+            break;
+        case SCPI_CLS:
+            scpi.clear_errors();
+            break;
+        case SCPI_OPC: {
+            // everything queued before this has already gone out, so lock is the last thing left to wait for
+            bool locked = true;
+            for (int d = 0; d < count; d++)
+                locked = (sel[d]->wait_for_lock(100000) >= 0) && locked;
+            if (!locked)
+                scpi.push_error(SCPI_ERR_DEVICE);
+            snprintf(reply, sizeof(reply), "1\n");
+            break;
+        }
+    }
+    sched_release();
+    if (reply[0]) printf("%s", reply);
+}
+
+// the message currently coming in over the bulk interface
+struct bulk_message_state {
+    uint8_t header[8];
+    int header_len;
+    uint16_t type;
+    uint32_t remaining;
+    uint8_t value[8]; // a float64 or stream mask that straddles two transfers
+    int value_len;
+    uint32_t taken;   // plans added or loaded
+    LMX2592PlanLoader loader;
+    LMX2592PlanLoader::status load_status;
+};
+bulk_message_state bulk_message;
+
+void bulk_send_status(uint16_t message, uint16_t status, uint32_t value) {
+    uint8_t record[4 + 8];
+    bulk_record_header(record, BULK_REC_STATUS, 0, 8);
+    memcpy(record + 4, &message, 2);
+    memcpy(record + 6, &status, 2);
+    memcpy(record + 8, &value, 4);
+    usb_bulk_write(record, sizeof(record));
+}
+
+// one whole value of a list message (float64 frequency or uint32 stream mask)
+void bulk_take_value(bulk_message_state& msg) {
+    if (msg.type == BULK_MSG_FREQ_LIST) {
+        double freq_hz;
+        memcpy(&freq_hz, msg.value, 8);
+        LMX2592* sel[NUM_PLLS];
+        if (get_selected(sel) > 0 && plan_table.add_frequency(*sel[0], freq_hz) >= 0)
+            msg.taken++;
+    }
+    else {
+        uint32_t mask;
+        memcpy(&mask, msg.value, 4);
+        bulk_streams = mask;
+    }
+}
+
+// feeds one received transfer through the message parser. plan tables go straight from the USB buffer to the loader
+void bulk_take(const uint8_t* data, int len) {
+    bulk_message_state& msg = bulk_message;
+    while (len > 0) {
+        if (msg.header_len < 8) {
+            msg.header[msg.header_len++] = *data++;
+            len--;
+            if (msg.header_len < 8) continue;
+            msg.type = msg.header[0] | (msg.header[1] << 8);
+            msg.remaining = msg.header[4] | (msg.header[5] << 8) | (msg.header[6] << 16) | ((uint32_t) msg.header[7] << 24);
+            msg.value_len = 0;
+            msg.taken = 0;
+            if (msg.type == BULK_MSG_PLAN_TABLE) {
+                msg.loader.begin(&plan_table);
+                msg.load_status = LMX2592PlanLoader::LOAD_MORE;
+            }
+            else if (msg.type == BULK_MSG_FREQ_LIST && plan_table.count == 0) {
+                LMX2592* sel[NUM_PLLS];
+                if (get_selected(sel) > 0) plan_table.begin(*sel[0]);
+            }
+        }
+        else {
+            int n = (len < (int) msg.remaining) ? len : (int) msg.remaining;
+            if (msg.type == BULK_MSG_PLAN_TABLE) {
+                if (msg.load_status == LMX2592PlanLoader::LOAD_MORE)
+                    msg.load_status = msg.loader.feed(data, n);
+            }
+            else if (msg.type == BULK_MSG_FREQ_LIST || msg.type == BULK_MSG_STREAMS) {
+                int value_size = (msg.type == BULK_MSG_FREQ_LIST) ? 8 : 4;
+                for (int k = 0; k < n; k++) {
+                    msg.value[msg.value_len++] = data[k];
+                    if (msg.value_len == value_size) {
+                        bulk_take_value(msg);
+                        msg.value_len = 0;
+                    }
+                }
+            }
+            // BULK_MSG_SINK and unknown types: skipped over
+            data += n;
+            len -= n;
+            msg.remaining -= n;
+        }
+        if (msg.header_len == 8 && msg.remaining == 0) {
+            if (msg.type == BULK_MSG_PLAN_TABLE) {
+                if (msg.load_status != LMX2592PlanLoader::LOAD_DONE) plan_table.clear();
+                bulk_send_status(msg.type, msg.load_status, plan_table.count);
+            }
+            else {
+                bulk_send_status(msg.type, LMX2592PlanLoader::LOAD_DONE, msg.taken);
+            }
+            msg.header_len = 0;
+        }
+    }
+}
+
+// bulk interface upkeep: takes received transfers, runs the telemetry streams, and starts the next IN transfer
+void bulk_service() {
+    const uint8_t* data;
+    int len;
+    while ((len = usb_bulk_rx_acquire(&data)) > 0) {
+        sched_hold();
+        bulk_take(data, len);
+        sched_release();
+        usb_bulk_rx_release();
+    }
+
+    if (bulk_streams & (1u << BULK_REC_READBACK)) {
+        for (int i = 0; i < NUM_PLLS; i++) {
+            // read back straight into the USB buffer
+            uint8_t* record = usb_bulk_tx_reserve(4 + 148);
+            if (!record) break;
+            bulk_record_header(record, BULK_REC_READBACK, i, 148);
+            uint32_t time = time_us_32();
+            memcpy(record + 4, &time, 4);
+            sched_hold();
+            plls[i].read_all_values((uint16_t*) (record + 8), 0);
+            sched_release();
+            record[150] = record[151] = 0;
+            usb_bulk_tx_commit(4 + 148);
+        }
+    }
+    if (bulk_streams & (1u << BULK_REC_SOURCE)) {
+        static uint32_t sequence = 0;
+        while (usb_bulk_mounted() && usb_bulk_tx_room() >= 1024) {
+            uint8_t* record = usb_bulk_tx_reserve(1024);
+            bulk_record_header(record, BULK_REC_SOURCE, 0, 1020);
+            memcpy(record + 4, &sequence, 4);
+            memset(record + 8, (uint8_t) sequence, 1016);
+            sequence++;
+            usb_bulk_tx_commit(1024);
+        }
+    }
+    usb_bulk_flush();
+}
+
+// background work that runs whenever the CLI is waiting on the host. scheduled commands wait while it uses the driver,
+// which is each call on its own, never a whole pass
+void idle_tasks() {
+    for (int i = 0; i < NUM_PLLS; i++) {
+        sched_hold();
+        // scheduled retunes only go as far as the FCAL in the interrupt. the lock wait lets due commands through
+        int lock_time = plls[i].service_retune();
+        plls[i].service_lock_monitor();
+        sched_release();
+        if (lock_time == -1) log_event(LOG_WARN, EV_LOCK_TIMEOUT, i);
+    }
+    scpi_service();
+    bulk_service();
+    log_flush(8);
+}
+
+// fgets() for stdin that keeps idle_tasks() going while it waits. a command waiting on input (-import) lets go of
+// the scheduler meanwhile
+char* read_line(char* line, int size) {
+    int depth = sched_suspend();
+    int len = 0;
+    while (true) {
+        int c = getchar_timeout_us(0);
+        if (c == PICO_ERROR_TIMEOUT) {
+            idle_tasks();
+            continue;
+        }
+        if (len < size - 1)
+            line[len++] = (char) c;
+        if (c == '\n')
+            break;
+    }
+    line[len] = 0;
+    sched_resume(depth);
+    return line;
+}
+
+// sleep_ms() for commands, with the scheduler let go so nothing comes due behind it
+void command_sleep_ms(uint32_t ms) {
+    int depth = sched_suspend();
+    sleep_ms(ms);
+    sched_resume(depth);
+}
+
+const char* CAL_PROFILE_NAMES[] = {"default", "fast", "seeded"};
+
+// times calibration-to-lock at points spread (log spaced) across the output range, for every calibration profile.
+// each profile gets a warm-up pass first, so the seeded profile has learned its cores
+void calibration_benchmark(LMX2592* dev, int points) {
+    lmx2592_cal_profile original = dev->get_cal_profile();
+    // lock detect edges on MUXOUT give far finer timing than polling over SPI
+    bool monitor_was_on = dev->lock_monitor_enabled();
+    if (!monitor_was_on)
+        dev->enable_lock_monitor(true, false);
+
+    for (int profile = CAL_DEFAULT; profile <= CAL_SEEDED; profile++) {
+        dev->set_cal_profile((lmx2592_cal_profile) profile);
+        uint32_t sum = 0;
+        int worst = 0;
+        int failures = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int p = 0; p < points; p++) {
+                double freq = 20'000'000.0 * pow(9'800'000'000.0 / 20'000'000.0, (double) p / (points - 1));
+                dev->set_frequency(freq);
+                int lock_time = dev->wait_for_lock(20000);
+                if (pass == 0) continue;
+                printf("CAL,%s,%.3f,%.3f,%d\n", CAL_PROFILE_NAMES[profile], freq / 1e6, dev->get_vco_hz() / 1e6, lock_time);
+                if (lock_time < 0) {
+                    failures++;
+                    continue;
+                }
+                sum += lock_time;
+                if (lock_time > worst) worst = lock_time;
+            }
+        }
+        int locked = points - failures;
+        printf("> %-8s mean %d us, worst %d us, %d of %d points failed to lock\n", CAL_PROFILE_NAMES[profile],
+            locked > 0 ? (int) (sum / locked) : -1, worst, failures, points);
+    }
+
+    dev->set_cal_profile(original);
+    if (!monitor_was_on)
+        dev->enable_lock_monitor(false, false);
+}
+
+// hops between two frequencies with fast-lock off, then on, and reports the mean/worst acquisition time of each
+void fastlock_compare(LMX2592* dev, double f1, double f2, int hops) {
+    bool was_on = dev->fastlock_enabled();
+    for (int mode = 0; mode < 2; mode++) {
+        dev->set_fastlock(mode == 1);
+        uint32_t sum = 0;
+        int worst = 0;
+        int failures = 0;
+        for (int k = 0; k < hops; k++) {
+            dev->set_frequency((k & 1) ? f2 : f1);
+            int lock_time = dev->wait_for_lock(10000);
+            if (lock_time < 0) {
+                failures++;
+                continue;
+            }
+            sum += lock_time;
+            if (lock_time > worst) worst = lock_time;
+        }
+        int locked = hops - failures;
+        printf("> Fast-lock %-3s: mean %d us, worst %d us, %d of %d hops failed to lock\n", mode ? "on" : "off",
+            locked > 0 ? (int) (sum / locked) : -1, worst, failures, hops);
+    }
+    dev->set_fastlock(was_on);
+}
+
+// reads a TICS Pro register export line by line until "end" or a blank line, then applies it to the selected
+// devices in one burst with one calibration
+void import_ticspro() {
+    static TicsProImport import;
+    import.reset();
+    printf("> Paste the TICS Pro register list, finish with a blank line or \"end\"\n");
+
+    char line[128];
+    int line_num = 0;
+    while (true) {
+        read_line(line, sizeof(line));
+        line_num++;
+        char* text = line;
+        while (*text == ' ' || *text == '\t') text++;
+        if (*text == '\r' || *text == '\n' || *text == 0 || strncmp(text, "end", 3) == 0)
+            break;
+        TicsProImport::status status = import.feed_line(text);
+        if (status == TicsProImport::LINE_BAD_FORMAT)
+            printf("> line %d: not a register line: %s", line_num, line);
+        else if (status == TicsProImport::LINE_BAD_ADDRESS)
+            printf("> line %d: bad register address: %s", line_num, line);
+    }
+
+    if (import.errors > 0) {
+        printf("> Import aborted, %d bad lines\n", import.errors);
+        return;
+    }
+    int ignored = 0;
+    for (int a = 0; a < 71; a++) {
+        if (import.present[a] && !plls[0].is_managed_register(a)) ignored++;
+    }
+
+    LMX2592* sel[NUM_PLLS];
+    int count = get_selected(sel);
+    lmx2592_fields backup[NUM_PLLS];
+    for (int d = 0; d < count; d++) {
+        backup[d] = sel[d]->config_fields;
+    }
+    for (int d = 0; d < count; d++) {
+        bool bad[71];
+        if (!sel[d]->load_image_into_config(import.image, import.present, bad)) {
+            for (int a = 0; a < 71; a++) {
+                if (bad[a]) printf("> R%d 0x%04x: reserved bits don't match\n", a, import.image[a]);
+            }
+            // devices before this one already took the image into their config, put them back in sync
+            for (int k = 0; k < d; k++) {
+                sel[k]->config_fields = backup[k];
+                sel[k]->load_values_into_regfile();
+            }
+            printf("> Import aborted, nothing written\n");
+            return;
+        }
+    }
+    LMX2592::broadcast_write_all(sel, count);
+    LMX2592::broadcast_fcal(sel, count);
+    printf("> Imported %d registers (%d read-only or unmanaged ones ignored)\n", import.registers, ignored);
+    for (int d = 0; d < count; d++) {
+        int lock_time = sel[d]->wait_for_lock(10000);
+        if (lock_time < 0)
+            log_event(LOG_ERROR, EV_LOCK_TIMEOUT, pll_index(sel[d]));
+        else
+            log_event(LOG_INFO, EV_LOCKED, pll_index(sel[d]), lock_time);
+    }
+}
+
+// takes a binary plan table (from tools/plan_compiler) straight off stdin into plan_table
+void upload_plans() {
+    const char* STATUS_NAMES[] = {"incomplete", "done", "bad header", "too big for the table", "bad record", "bad CRC"};
+    printf("> Ready for plan table\n");
+    LMX2592PlanLoader loader;
+    loader.begin(&plan_table);
+    LMX2592PlanLoader::status status = LMX2592PlanLoader::LOAD_MORE;
+    uint64_t start_time = time_us_64();
+    // only the table is written, none of the devices, so the scheduler doesn't have to wait for the stream
+    int depth = sched_suspend();
+    while (status == LMX2592PlanLoader::LOAD_MORE) {
+        // give up after a second of silence
+        int c = getchar_timeout_us(1'000'000);
+        if (c == PICO_ERROR_TIMEOUT) break;
+        uint8_t byte = (uint8_t) c;
+        status = loader.feed(&byte, 1);
+    }
+    sched_resume(depth);
+    uint64_t total = time_us_64() - start_time;
+    if (status == LMX2592PlanLoader::LOAD_DONE) {
+        printf("> Loaded %d plans, %d bytes in %d us\n", plan_table.count, loader.received(), (int) total);
+    }
+    else {
+        plan_table.clear();
+        printf("> Error: plan upload failed after %d bytes (%s)\n", loader.received(), STATUS_NAMES[status]);
+    }
+}
 
 void get_inputs() {
     // Fixed-size buffers
@@ -38,13 +545,27 @@ void get_inputs() {
     int  flag_b = 0;
     char name[64] = {0}; // fixed buffer for string
 
-    printf("\n");
-    if (!fgets(line, sizeof(line), stdin)) {
+    if (!read_line(line, sizeof(line))) {
         printf("Error reading input\n");
         //return 1;
     }
+    // anything that doesn't start like a CLI command is SCPI. no echo or prompt, replies are the only output
+    const char* first = line;
+    while (*first == ' ' || *first == '\t') first++;
+    if (*first != '-' && *first != '\r' && *first != '\n' && *first != 0) {
+        while (scpi.free() < ((int) strlen(line) + 1) / 2)
+            scpi_service();
+        scpi.feed_line(line);
+        return;
+    }
+    // CLI commands run after anything SCPI still has queued
+    while (!scpi.empty())
+        scpi_service();
+    // scheduled commands don't cut into a command line's use of the driver. its waits let go: lock waits between
+    // polls (lock_wait_gap), input with read_line() and upload_plans(), dwell with command_sleep_ms()
+    sched_hold();
 
-    printf("< %s", line);
+    printf("\n< %s", line);
 
     // Tokenize line in-place (no allocation)
     argc = 0;
@@ -58,42 +579,84 @@ void get_inputs() {
     for (int i = 0; i < argc; i++) {
         if (strcmp(argv[i], "-help") == 0) {
             printf("Usage:\n");    
+            printf("  -dev <n/all>  Select which synthesizer(s) the following commands go to [0, %d]\n", NUM_PLLS - 1);
             printf("  -f <float>    Set frequency in MHz [20.0, 9800.0]\n");
             printf("  -p <int>      Set RF power [0, 47]\n");
             printf("  -rf1 <on/off> Enable RF1\n");
             printf("  -rf2 <on/off> Enable RF2\n");
             printf("  -d <bin/hex>  Dump LMX2592 registers\n");
+            printf("  -sweep <start> <stop> <step> [dwell ms]  Step the frequency in MHz, waiting for lock each time\n");
+            printf("  -jitter <f1> <f2> [n]  Measure retune latency hopping between two frequencies in MHz\n");
+            printf("  -lockmon <on/auto/off/log/clear>  Background lock monitor (auto = also relock on unlock)\n");
+            printf("  -trace <on/off/clear/dump>  Record every SPI frame with a timestamp, or print the record\n");
+            printf("  -replay       Re-send the recorded writes with their original timing\n");
+            printf("  -import       Load a TICS Pro register list (as printed by -d hex)\n");
+            printf("  -cal <default/fast/seeded>  Select how the VCO calibration runs on each retune\n");
+            printf("  -calbench [points]  Time calibration to lock for every profile across the band\n");
+            printf("  -standby      Power the synthesizer down, keeping its registers and calibration\n");
+            printf("  -wake         Power back up from standby and report wake-to-lock time\n");
+            printf("  -fastlock <on/off>  Boost the charge pump while acquiring lock on every retune\n");
+            printf("  -fastlock cmp <f1> <f2> [n]  Compare acquisition time with and without fast-lock\n");
+            printf("  -log <error/warn/info/debug/stats>  Set how chatty the deferred log is, or show its counters\n");
+            printf("  -train        Retrain the SPI link and report the chosen clock\n");
+            printf("  -plan <add/range/go/sweep/info/clear/upload>  Precompute hop plans and retune straight from them\n");
+            printf("  -preset [n]   List the presets built into the firmware, or switch to preset n\n");
+            printf("  -stats        FCALs done and skipped, and SPI frames sent, per device\n");
+            printf("  -time         Print the 64-bit microsecond timer that -at runs on\n");
+            printf("  -at <us/+us> <f/p/rf1/rf2> <value>  Queue a setting for an absolute (or relative) timer value\n");
+            printf("  -sched [log/clear]  Scheduled command counters and lateness, or the per-command log\n");
+            printf("  -bulk <lock/readback/source/off/stats>  Telemetry streams on the USB bulk interface, or its counters\n");
+            printf("SCPI: FREQ, POW, OUTP1/2, SYST:ERR?, *IDN?, *RST, *CLS, *OPC? (see README)\n");
             printf("  -reboot       Reboot RP2040 into USB boot mode (for reprogramming)\n");
             printf("  -about        About this board\n");
             printf("If you don't see an output, make sure to enable an output channel first!\n");
             continue;
         }
 
+        else if (strcmp(argv[i], "-dev") == 0) {
+            if (i + 1 < argc) {
+                i++;
+                if ((strcmp(argv[i], "all") == 0) || (strcmp(argv[i], "ALL") == 0)) {
+                    selected_plls = (1u << NUM_PLLS) - 1;
+                    printf("> Selected all %d devices\n", NUM_PLLS);
+                }
+                else {
+                    int arg = atoi(argv[i]);
+                    if (arg >= 0 && arg < NUM_PLLS) {
+                        selected_plls = 1u << arg;
+                        printf("> Selected device %d\n", arg);
+                    }
+                    else {
+                        printf("> Error: device out of bounds (0 to %d)\n", NUM_PLLS - 1);
+                    }
+                }
+            }
+            else {
+                printf("> Usage: -dev <n/all>\n> Example: -dev all\n");
+            }
+        }
         else if (strcmp(argv[i], "-f") == 0) {
             if (i + 1 < argc) {
                 double arg = atof(argv[++i]);
-                if (pll.set_frequency(arg * 1'000'000.0)) {
-                    printf("> Frequency set to %f MHz\n", arg);
-                    sleep_ms(50);
+                LMX2592* sel[NUM_PLLS];
+                int count = get_selected(sel);
+                // the whole group is retuned in one bus pass and calibrates together
+                double freq_hz = arg * 1'000'000.0;
+                if (LMX2592::broadcast_frequency(sel, count, freq_hz)) {
+                    log_event(LOG_INFO, EV_FREQ_SET, freq_mhz(freq_hz), freq_hz_rem(freq_hz));
+                    command_sleep_ms(50);
                     
-                    uint64_t start_time = to_us_since_boot(get_absolute_time());
-                    int timeout = 10000; // 10 ms
-                    uint64_t delta_time;
-                    bool locked = true;
-                    while(!pll.is_locked()) {
-                        sleep_us(10);
-                        delta_time = to_us_since_boot(get_absolute_time()) - start_time;
-                        if (delta_time > timeout) {
-                            printf("> PLL could not lock. Maybe there is a problem\n");
-                            locked = false;
-                            break;
-                        }
+                    for (int d = 0; d < count; d++) {
+                        int lock_time = sel[d]->wait_for_lock(10000); // 10 ms
+                        telemetry_lock(sel[d], freq_hz, lock_time);
+                        if (lock_time < 0)
+                            log_event(LOG_ERROR, EV_LOCK_TIMEOUT, pll_index(sel[d]));
+                        else
+                            log_event(LOG_INFO, EV_LOCKED, pll_index(sel[d]), lock_time);  
                     }
-                    if (locked)
-                        printf("> PLL locked successfully after %d us\n", delta_time);  
                 } 
                 else {
-                    printf("> Error: frequency out of bounds\n");
+                    log_event(LOG_ERROR, EV_FREQ_BOUNDS);
                 }
             }
             else {
@@ -103,7 +666,12 @@ void get_inputs() {
         else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
             if (i + 1 < argc) {
                 int arg = atoi(argv[++i]);
-                if (pll.set_power_int(arg)) {
+                LMX2592* sel[NUM_PLLS];
+                int count = get_selected(sel);
+                bool ok = true;
+                for (int d = 0; d < count; d++)
+                    ok = ok && sel[d]->set_power_int(arg);
+                if (ok) {
                     printf("> Power set to setting %d\n", arg);
                 }
                 else {
@@ -117,11 +685,17 @@ void get_inputs() {
         else if (strcmp(argv[i], "-rf1") == 0) {
             if (i + 1 < argc) {
                 if ((strcmp(argv[i + 1], "on") == 0) || (strcmp(argv[i + 1], "ON") == 0)) {
-                    pll.enable_rf1(1);
+                    LMX2592* sel[NUM_PLLS];
+                    int count = get_selected(sel);
+                    for (int d = 0; d < count; d++)
+                        sel[d]->enable_rf1(1);
                     printf("> RF channel 1 ON\n");
                 }
                 else if ((strcmp(argv[i + 1], "off") == 0) || (strcmp(argv[i + 1], "OFF") == 0)) {
-                    pll.enable_rf1(0);
+                    LMX2592* sel[NUM_PLLS];
+                    int count = get_selected(sel);
+                    for (int d = 0; d < count; d++)
+                        sel[d]->enable_rf1(0);
                     printf("> RF channel 1 OFF\n");
                 }
                 else {
@@ -136,11 +710,17 @@ void get_inputs() {
         else if (strcmp(argv[i], "-rf2") == 0) {
             if (i + 1 < argc) {
                 if ((strcmp(argv[i + 1], "on") == 0) || (strcmp(argv[i + 1], "ON") == 0)) {
-                    pll.enable_rf2(1);
+                    LMX2592* sel[NUM_PLLS];
+                    int count = get_selected(sel);
+                    for (int d = 0; d < count; d++)
+                        sel[d]->enable_rf2(1);
                     printf("> RF channel 2 ON\n");
                 }
                 else if ((strcmp(argv[i + 1], "off") == 0) || (strcmp(argv[i + 1], "OFF") == 0)) {
-                    pll.enable_rf2(0);
+                    LMX2592* sel[NUM_PLLS];
+                    int count = get_selected(sel);
+                    for (int d = 0; d < count; d++)
+                        sel[d]->enable_rf2(0);
                     printf("> RF channel 2 OFF\n");
                 }
                 else {
@@ -154,11 +734,15 @@ void get_inputs() {
         }
         else if (strcmp(argv[i], "-d") == 0) {
             if (i + 1 < argc) {
+                LMX2592* sel[NUM_PLLS];
+                int count = get_selected(sel);
                 if ((strcmp(argv[i + 1], "hex") == 0) || (strcmp(argv[i + 1], "h") == 0)) {
-                    pll.dump_values(true);
+                    for (int d = 0; d < count; d++)
+                        sel[d]->dump_values(true);
                 }
                 else if ((strcmp(argv[i + 1], "bin") == 0) || (strcmp(argv[i + 1], "b") == 0)) {
-                    pll.dump_values(false);
+                    for (int d = 0; d < count; d++)
+                        sel[d]->dump_values(false);
                 }
                 else {
                     printf("> Usage: -d <hex/bin>\n> Example: -d hex\n");
@@ -170,6 +754,506 @@ void get_inputs() {
             printf("> Dumped registers\n");
             i++;
         }
+        else if (strcmp(argv[i], "-sweep") == 0) {
+            if (i + 3 < argc) {
+                double start = atof(argv[++i]) * 1'000'000.0;
+                double stop = atof(argv[++i]) * 1'000'000.0;
+                double step = atof(argv[++i]) * 1'000'000.0;
+                int dwell_ms = 0;
+                if (i + 1 < argc && argv[i + 1][0] != '-')
+                    dwell_ms = atoi(argv[++i]);
+                if (step <= 0.0 || stop < start) {
+                    printf("> Error: need start <= stop and step > 0\n");
+                    continue;
+                }
+                LMX2592* sel[NUM_PLLS];
+                int count = get_selected(sel);
+                int steps = 0;
+                int failures = 0;
+                int worst = 0;
+                uint64_t start_time = time_us_64();
+                for (double freq = start; freq <= stop; freq += step) {
+                    int lock_time = sweep_step(sel, count, freq);
+                    steps++;
+                    if (lock_time < 0)
+                        failures++;
+                    else if (lock_time > worst)
+                        worst = lock_time;
+                    if (dwell_ms > 0)
+                        command_sleep_ms(dwell_ms);
+                }
+                uint64_t total = time_us_64() - start_time;
+                printf("> Swept %d steps in %d us, %d failed to lock, slowest lock %d us\n", steps, (int) total, failures, worst);
+            }
+            else {
+                printf("> Usage: -sweep <start MHz> <stop MHz> <step MHz> [dwell ms]\n> Example: -sweep 1000 2000 100 10\n");
+            }
+        }
+        else if (strcmp(argv[i], "-jitter") == 0) {
+            if (i + 2 < argc) {
+                double freqs[2];
+                freqs[0] = atof(argv[++i]) * 1'000'000.0;
+                freqs[1] = atof(argv[++i]) * 1'000'000.0;
+                int n = 100;
+                if (i + 1 < argc && argv[i + 1][0] != '-')
+                    n = atoi(argv[++i]);
+                LMX2592* sel[NUM_PLLS];
+                int count = get_selected(sel);
+                // the latency covers planning, the register write-out and the lock wait
+                uint32_t min_us = UINT32_MAX;
+                uint32_t max_us = 0;
+                double sum = 0;
+                double sum_sq = 0;
+                int good = 0;
+                for (int k = 0; k < n; k++) {
+                    uint64_t t0 = time_us_64();
+                    int lock_time = sweep_step(sel, count, freqs[k & 1]);
+                    uint32_t elapsed = (uint32_t) (time_us_64() - t0);
+                    if (lock_time < 0) continue;
+                    good++;
+                    if (elapsed < min_us) min_us = elapsed;
+                    if (elapsed > max_us) max_us = elapsed;
+                    sum += elapsed;
+                    sum_sq += (double) elapsed * elapsed;
+                }
+                if (good == 0) {
+                    printf("> Error: PLL never locked\n");
+                    continue;
+                }
+                double mean = sum / good;
+                double var = sum_sq / good - mean * mean;
+                printf("> Retune latency (%s build, sys %d kHz, SPI %d Hz), %d of %d hops locked:\n",
+                    BUILD_PROFILE, (int) (clock_get_hz(clk_sys) / 1000), (int) sel[0]->get_spi_baud(), good, n);
+                printf(">   min %d us, max %d us, mean %.1f us, jitter (max - min) %d us, std dev %.1f us\n",
+                    (int) min_us, (int) max_us, mean, (int) (max_us - min_us), var > 0 ? __builtin_sqrt(var) : 0.0);
+            }
+            else {
+                printf("> Usage: -jitter <f1 MHz> <f2 MHz> [hops]\n> Example: -jitter 2400 2500 200\n");
+            }
+        }
+        else if (strcmp(argv[i], "-lockmon") == 0) {
+            if (i + 1 < argc) {
+                i++;
+                LMX2592* sel[NUM_PLLS];
+                int count = get_selected(sel);
+                for (int d = 0; d < count; d++) {
+                    if ((strcmp(argv[i], "on") == 0) || (strcmp(argv[i], "auto") == 0)) {
+                        bool relock = strcmp(argv[i], "auto") == 0;
+                        if (sel[d]->enable_lock_monitor(true, relock))
+                            printf("> Lock monitor on%s\n", relock ? ", with auto relock" : "");
+                        else
+                            printf("> Error: lock monitor needs a MUXOUT pin per device\n");
+                    }
+                    else if (strcmp(argv[i], "off") == 0) {
+                        sel[d]->enable_lock_monitor(false, false);
+                        printf("> Lock monitor off\n");
+                    }
+                    else if (strcmp(argv[i], "log") == 0) {
+                        lmx2592_lock_event events[32];
+                        int num_events = sel[d]->get_lock_log(events, 32);
+                        for (int e = 0; e < num_events; e++) {
+                            printf(">   %llu us: %s\n", (unsigned long long) events[e].time_us, events[e].locked ? "relocked" : "UNLOCKED");
+                        }
+                        printf("> Monitor %s, %d unlocks, %d relocks, %d auto relocks, recovery last %d us / max %d us\n",
+                            sel[d]->lock_monitor_enabled() ? "on" : "off", (int) sel[d]->unlock_count, (int) sel[d]->relock_count,
+                            (int) sel[d]->auto_relock_count, (int) sel[d]->last_recovery_us, (int) sel[d]->max_recovery_us);
+                    }
+                    else if (strcmp(argv[i], "clear") == 0) {
+                        sel[d]->clear_lock_log();
+                        printf("> Lock log cleared\n");
+                    }
+                    else {
+                        printf("> Usage: -lockmon <on/auto/off/log/clear>\n> Example: -lockmon auto\n");
+                        break;
+                    }
+                }
+            }
+            else {
+                printf("> Usage: -lockmon <on/auto/off/log/clear>\n> Example: -lockmon auto\n");
+            }
+        }
+        else if (strcmp(argv[i], "-trace") == 0) {
+            if (i + 1 < argc) {
+                i++;
+                if (strcmp(argv[i], "on") == 0) {
+                    spi_trace_enabled = true;
+                    printf("> SPI trace on\n");
+                }
+                else if (strcmp(argv[i], "off") == 0) {
+                    spi_trace_enabled = false;
+                    printf("> SPI trace off\n");
+                }
+                else if (strcmp(argv[i], "clear") == 0) {
+                    spi_trace_clear();
+                    printf("> SPI trace cleared\n");
+                }
+                else if (strcmp(argv[i], "dump") == 0) {
+                    spi_trace_dump();
+                }
+                else {
+                    printf("> Usage: -trace <on/off/clear/dump>\n> Example: -trace dump\n");
+                }
+            }
+            else {
+                printf("> Usage: -trace <on/off/clear/dump>\n> Example: -trace dump\n");
+            }
+        }
+        else if (strcmp(argv[i], "-replay") == 0) {
+            // raw frames: the driver's shadow registers don't follow along
+            uint32_t max_late_us;
+            int sent = spi_trace_replay(all_plls, NUM_PLLS, &max_late_us);
+            printf("> Replayed %d frames, worst lateness %d us\n", sent, (int) max_late_us);
+        }
+        else if (strcmp(argv[i], "-import") == 0) {
+            import_ticspro();
+        }
+        else if (strcmp(argv[i], "-cal") == 0) {
+            if (i + 1 < argc) {
+                i++;
+                int profile = -1;
+                for (int k = CAL_DEFAULT; k <= CAL_SEEDED; k++) {
+                    if (strcmp(argv[i], CAL_PROFILE_NAMES[k]) == 0) profile = k;
+                }
+                if (profile >= 0) {
+                    LMX2592* sel[NUM_PLLS];
+                    int count = get_selected(sel);
+                    for (int d = 0; d < count; d++)
+                        sel[d]->set_cal_profile((lmx2592_cal_profile) profile);
+                    printf("> Calibration profile %s, takes effect on the next retune\n", CAL_PROFILE_NAMES[profile]);
+                }
+                else {
+                    printf("> Usage: -cal <default/fast/seeded>\n> Example: -cal seeded\n");
+                }
+            }
+            else {
+                printf("> Usage: -cal <default/fast/seeded>\n> Example: -cal seeded\n");
+            }
+        }
+        else if (strcmp(argv[i], "-calbench") == 0) {
+            int points = 24;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                points = atoi(argv[++i]);
+            if (points < 2) points = 2;
+            LMX2592* sel[NUM_PLLS];
+            int count = get_selected(sel);
+            if (count > 0) {
+                printf("> profile,freq MHz,VCO MHz,lock us\n");
+                calibration_benchmark(sel[0], points);
+            }
+        }
+        else if (strcmp(argv[i], "-standby") == 0) {
+            LMX2592* sel[NUM_PLLS];
+            int count = get_selected(sel);
+            for (int d = 0; d < count; d++)
+                sel[d]->standby();
+            printf("> Standby, use -wake to power back up\n");
+        }
+        else if (strcmp(argv[i], "-wake") == 0) {
+            LMX2592* sel[NUM_PLLS];
+            int count = get_selected(sel);
+            for (int d = 0; d < count; d++) {
+                if (!sel[d]->in_standby()) {
+                    printf("> Not in standby\n");
+                    continue;
+                }
+                bool recalibrated;
+                int wake_time = sel[d]->wake(10000, &recalibrated);
+                if (wake_time < 0)
+                    log_event(LOG_ERROR, EV_WAKE_TIMEOUT, pll_index(sel[d]));
+                else
+                    log_event(LOG_INFO, EV_WAKE, pll_index(sel[d]), wake_time, recalibrated);
+            }
+        }
+        else if (strcmp(argv[i], "-fastlock") == 0) {
+            LMX2592* sel[NUM_PLLS];
+            int count = get_selected(sel);
+            if (i + 1 < argc && (strcmp(argv[i + 1], "on") == 0 || strcmp(argv[i + 1], "off") == 0)) {
+                bool enabled = strcmp(argv[++i], "on") == 0;
+                for (int d = 0; d < count; d++)
+                    sel[d]->set_fastlock(enabled);
+                printf("> Fast-lock %s\n", enabled ? "on" : "off");
+            }
+            else if (i + 3 < argc && strcmp(argv[i + 1], "cmp") == 0) {
+                i++;
+                double f1 = atof(argv[++i]) * 1'000'000.0;
+                double f2 = atof(argv[++i]) * 1'000'000.0;
+                int hops = 20;
+                if (i + 1 < argc && argv[i + 1][0] != '-')
+                    hops = atoi(argv[++i]);
+                if (count > 0)
+                    fastlock_compare(sel[0], f1, f2, hops);
+            }
+            else {
+                printf("> Usage: -fastlock <on/off>, or -fastlock cmp <f1 MHz> <f2 MHz> [hops]\n> Example: -fastlock cmp 1000 6000 20\n");
+            }
+        }
+        else if (strcmp(argv[i], "-log") == 0) {
+            const char* LEVEL_NAMES[] = {"error", "warn", "info", "debug"};
+            if (i + 1 < argc) {
+                i++;
+                bool found = false;
+                for (int k = LOG_ERROR; k <= LOG_DEBUG; k++) {
+                    if (strcmp(argv[i], LEVEL_NAMES[k]) == 0) {
+                        log_verbosity = (log_level) k;
+                        found = true;
+                        printf("> Log level %s\n", LEVEL_NAMES[k]);
+                    }
+                }
+                if (!found && strcmp(argv[i], "stats") == 0) {
+                    printf("> Log level %s, %d records queued, %d dropped\n", LEVEL_NAMES[log_verbosity],
+                        (int) log_pending(), (int) log_dropped);
+                }
+                else if (!found) {
+                    printf("> Usage: -log <error/warn/info/debug/stats>\n> Example: -log debug\n");
+                }
+            }
+            else {
+                printf("> Usage: -log <error/warn/info/debug/stats>\n> Example: -log debug\n");
+            }
+        }
+        else if (strcmp(argv[i], "-train") == 0) {
+            LMX2592* sel[NUM_PLLS];
+            int count = get_selected(sel);
+            for (int d = 0; d < count; d++) {
+                lmx2592_link_result results[LMX2592::MAX_LINK_RATES];
+                int num_results;
+                uint32_t baud = sel[d]->train_spi(results, &num_results);
+                for (int r = 0; r < num_results; r++) {
+                    printf(">   %8d Hz: %d errors\n", (int) results[r].baud, results[r].errors);
+                }
+                printf("> SPI link trained to %d Hz\n", (int) baud);
+            }
+        }
+        else if (strcmp(argv[i], "-plan") == 0) {
+            LMX2592* sel[NUM_PLLS];
+            int count = get_selected(sel);
+            const char* usage = "> Usage: -plan add <MHz...>, -plan range <start MHz> <stop MHz> <step MHz>, -plan go <index>,\n"
+                "> -plan sweep [dwell ms], -plan info, -plan clear, -plan upload\n> Example: -plan range 1000 2000 10\n";
+            if (i + 1 >= argc || count == 0) {
+                printf("%s", usage);
+                continue;
+            }
+            i++;
+            if (strcmp(argv[i], "add") == 0 || strcmp(argv[i], "range") == 0) {
+                // plans are taken against the first selected device, the base image is its state when the table starts
+                if (plan_table.count == 0) plan_table.begin(*sel[0]);
+                int added = 0;
+                int failed = 0;
+                if (strcmp(argv[i], "range") == 0) {
+                    if (i + 3 >= argc) {
+                        printf("%s", usage);
+                        continue;
+                    }
+                    double start = atof(argv[++i]) * 1'000'000.0;
+                    double stop = atof(argv[++i]) * 1'000'000.0;
+                    double step = atof(argv[++i]) * 1'000'000.0;
+                    if (step <= 0.0 || stop < start) {
+                        printf("> Error: need start <= stop and step > 0\n");
+                        continue;
+                    }
+                    for (double freq = start; freq <= stop; freq += step) {
+                        if (plan_table.add_frequency(*sel[0], freq) < 0) failed++;
+                        else added++;
+                    }
+                }
+                else {
+                    while (i + 1 < argc && argv[i + 1][0] != '-') {
+                        if (plan_table.add_frequency(*sel[0], atof(argv[++i]) * 1'000'000.0) < 0) failed++;
+                        else added++;
+                    }
+                }
+                printf("> Added %d plans (%d failed: out of range or table full), %d in table\n", added, failed, plan_table.count);
+            }
+            else if (strcmp(argv[i], "go") == 0 && i + 1 < argc) {
+                int index = atoi(argv[++i]);
+                if (index < 0 || index >= plan_table.count) {
+                    printf("> Error: no plan %d, the table has %d\n", index, plan_table.count);
+                    continue;
+                }
+                for (int d = 0; d < count; d++) {
+                    uint64_t start_time = time_us_64();
+                    plan_table.apply(index, *sel[d]);
+                    int lock_time = (sel[d]->wait_for_lock(100000) >= 0) ? (int) (time_us_64() - start_time) : -1;
+                    telemetry_lock(sel[d], sel[d]->output_from_config(), lock_time);
+                    printf("> Device %d on plan %d (VCO %.6f MHz), locked in %d us\n", pll_index(sel[d]), index,
+                        sel[d]->get_vco_hz() / 1'000'000.0, lock_time);
+                }
+            }
+            else if (strcmp(argv[i], "sweep") == 0) {
+                int dwell_ms = 0;
+                if (i + 1 < argc && argv[i + 1][0] != '-')
+                    dwell_ms = atoi(argv[++i]);
+                int failures = 0;
+                int worst = 0;
+                uint64_t start_time = time_us_64();
+                for (int p = 0; p < plan_table.count; p++) {
+                    uint64_t hop_start = time_us_64();
+                    for (int d = 0; d < count; d++)
+                        plan_table.apply(p, *sel[d]);
+                    bool locked = true;
+                    for (int d = 0; d < count; d++) {
+                        int lock_time = sel[d]->wait_for_lock(100000);
+                        locked = (lock_time >= 0) && locked;
+                        telemetry_lock(sel[d], sel[d]->output_from_config(), lock_time);
+                    }
+                    int hop_time = (int) (time_us_64() - hop_start);
+                    if (!locked) failures++;
+                    else if (hop_time > worst) worst = hop_time;
+                    if (dwell_ms > 0)
+                        command_sleep_ms(dwell_ms);
+                }
+                uint64_t total = time_us_64() - start_time;
+                printf("> Hopped through %d plans in %d us, %d failed to lock, slowest hop %d us\n", plan_table.count,
+                    (int) total, failures, worst);
+            }
+            else if (strcmp(argv[i], "info") == 0) {
+                int total = plan_table.total_bytes();
+                printf("> %d plans, %d bytes including the %d byte base image (%.1f bytes per plan, %d for a full driver state)\n",
+                    plan_table.count, total, (int) sizeof(plan_table.base),
+                    plan_table.count ? (double) (total - (int) sizeof(plan_table.base)) / plan_table.count : 0.0,
+                    LMX2592PlanTable::FULL_PLAN_BYTES);
+                printf("> Room for %d more plans, %d pool words free\n", LMX2592PlanTable::MAX_PLANS - plan_table.count,
+                    LMX2592PlanTable::POOL_WORDS - plan_table.pool_used);
+            }
+            else if (strcmp(argv[i], "clear") == 0) {
+                plan_table.clear();
+                printf("> Plan table cleared\n");
+            }
+            else if (strcmp(argv[i], "upload") == 0) {
+                upload_plans();
+            }
+            else {
+                printf("%s", usage);
+            }
+        }
+        else if (strcmp(argv[i], "-preset") == 0) {
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                for (int k = 0; k < NUM_LMX2592_PRESETS; k++)
+                    printf("> %d: %.6f MHz\n", k, lmx2592_presets[k].freq_hz / 1'000'000.0);
+                printf("> Boot: %.6f MHz\n", lmx2592_boot_preset.freq_hz / 1'000'000.0);
+                continue;
+            }
+            int index = atoi(argv[++i]);
+            if (index < 0 || index >= NUM_LMX2592_PRESETS) {
+                printf("> Error: no preset %d, the firmware has %d\n", index, NUM_LMX2592_PRESETS);
+                continue;
+            }
+            LMX2592* sel[NUM_PLLS];
+            int count = get_selected(sel);
+            for (int d = 0; d < count; d++) {
+                uint64_t start_time = time_us_64();
+                lmx2592_apply_preset(lmx2592_presets[index], *sel[d]);
+                int lock_time = (sel[d]->wait_for_lock(100000) >= 0) ? (int) (time_us_64() - start_time) : -1;
+                telemetry_lock(sel[d], lmx2592_presets[index].freq_hz, lock_time);
+                printf("> Device %d on preset %d (%.6f MHz), locked in %d us\n", pll_index(sel[d]), index,
+                    lmx2592_presets[index].freq_hz / 1'000'000.0, lock_time);
+            }
+        }
+        else if (strcmp(argv[i], "-stats") == 0) {
+            LMX2592* sel[NUM_PLLS];
+            int count = get_selected(sel);
+            for (int d = 0; d < count; d++) {
+                uint32_t fcals = sel[d]->fcal_count;
+                uint32_t skipped = sel[d]->fcal_skipped;
+                printf("> Device %d: %u FCALs, %u retunes skipped one (VCO unchanged, %.1f%%), %u SPI frames\n",
+                    pll_index(sel[d]), (unsigned) fcals, (unsigned) skipped,
+                    (fcals + skipped) ? 100.0 * skipped / (fcals + skipped) : 0.0, (unsigned) sel[d]->bus_frames);
+            }
+        }
+        else if (strcmp(argv[i], "-time") == 0) {
+            printf("> %llu us\n", (unsigned long long) time_us_64());
+        }
+        else if (strcmp(argv[i], "-at") == 0) {
+            const char* usage = "> Usage: -at <us/+us> <f MHz/p power/rf1 on|off/rf2 on|off>\n> Example: -at +500000 f 2400\n";
+            if (i + 3 >= argc) {
+                printf("%s", usage);
+                continue;
+            }
+            const char* when = argv[++i];
+            const char* what = argv[++i];
+            const char* value = argv[++i];
+            uint64_t time_us = strtoull(when + (when[0] == '+'), nullptr, 10);
+            if (when[0] == '+') time_us += time_us_64();
+            LMX2592* sel[NUM_PLLS];
+            int count = get_selected(sel);
+            for (int d = 0; d < count; d++) {
+                int id;
+                if (strcmp(what, "f") == 0)
+                    id = sched_frequency(sel[d], time_us, atof(value) * 1'000'000.0);
+                else if (strcmp(what, "p") == 0)
+                    id = sched_power(sel[d], time_us, (uint16_t) atoi(value));
+                else if (strcmp(what, "rf1") == 0 || strcmp(what, "rf2") == 0)
+                    id = sched_output(sel[d], time_us, what[2] == '1' ? SCHED_RF1 : SCHED_RF2, strcmp(value, "on") == 0);
+                else {
+                    printf("%s", usage);
+                    break;
+                }
+                if (id == SCHED_ERR_FULL) printf("> Error: schedule full (%d queued)\n", sched_pending());
+                else if (id == SCHED_ERR_PAST) printf("> Error: %llu us has already gone by\n", (unsigned long long) time_us);
+                else if (id == SCHED_ERR_RANGE) printf("> Error: %s %s out of range\n", what, value);
+                else printf("> Device %d: #%d queued for %llu us\n", pll_index(sel[d]), id, (unsigned long long) time_us);
+            }
+        }
+        else if (strcmp(argv[i], "-sched") == 0) {
+            const char* OP_NAMES[] = {"f", "p", "rf1", "rf2"};
+            if (i + 1 < argc && strcmp(argv[i + 1], "clear") == 0) {
+                i++;
+                sched_clear();
+                printf("> Schedule cleared\n");
+            }
+            else if (i + 1 < argc && strcmp(argv[i + 1], "log") == 0) {
+                i++;
+                static sched_result results[SCHED_LOG_SIZE];
+                int n = sched_snapshot(results, SCHED_LOG_SIZE);
+                for (int k = 0; k < n; k++) {
+                    printf(">   #%lu dev %d %-3s at %llu us, %ld us late%s\n", (unsigned long) results[k].id,
+                        pll_index(results[k].dev), OP_NAMES[results[k].op], (unsigned long long) results[k].time_us,
+                        (long) results[k].late_us, results[k].deferred ? " (bus busy)" : "");
+                }
+            }
+            printf("> %d queued, %lu done (%lu held back by the CLI), worst %ld us late\n", sched_pending(),
+                (unsigned long) sched_executed, (unsigned long) sched_deferred, (long) sched_max_late_us);
+        }
+        else if (strcmp(argv[i], "-bulk") == 0) {
+            const char* STREAM_NAMES[] = {"", "lock", "readback", "", "source"};
+            if (i + 1 < argc) {
+                i++;
+                bool found = false;
+                for (int k = BULK_REC_LOCK; k <= BULK_REC_SOURCE; k++) {
+                    if (STREAM_NAMES[k][0] && strcmp(argv[i], STREAM_NAMES[k]) == 0) {
+                        bulk_streams |= 1u << k;
+                        found = true;
+                        printf("> Streaming %s records on the bulk interface\n", STREAM_NAMES[k]);
+                    }
+                }
+                if (!found && strcmp(argv[i], "off") == 0) {
+                    bulk_streams = 0;
+                    printf("> Bulk streams off\n");
+                }
+                else if (!found && strcmp(argv[i], "stats") == 0) {
+                    // rates since the last -bulk stats
+                    static uint64_t last_time = 0;
+                    static uint32_t last_rx = 0;
+                    static uint32_t last_tx = 0;
+                    uint64_t now = time_us_64();
+                    uint32_t rx = usb_bulk_rx_bytes;
+                    uint32_t tx = usb_bulk_tx_bytes;
+                    double seconds = (now - last_time) / 1'000'000.0;
+                    printf("> Bulk interface %s, %u bytes in (%.0f B/s), %u bytes out (%.0f B/s), %u records dropped\n",
+                        usb_bulk_mounted() ? "open" : "not configured", (unsigned) rx, (rx - last_rx) / seconds,
+                        (unsigned) tx, (tx - last_tx) / seconds, (unsigned) usb_bulk_tx_dropped);
+                    last_time = now;
+                    last_rx = rx;
+                    last_tx = tx;
+                }
+                else if (!found) {
+                    printf("> Usage: -bulk <lock/readback/source/off/stats>\n> Example: -bulk lock\n");
+                }
+            }
+            else {
+                printf("> Usage: -bulk <lock/readback/source/off/stats>\n> Example: -bulk lock\n");
+            }
+        }
         else if (strcmp(argv[i], "-reboot") == 0) {
             printf("> Rebooting into USB boot\n");
             reset_usb_boot(0, 0);
@@ -177,6 +1261,7 @@ void get_inputs() {
         else if (strcmp(argv[i], "-about") == 0) {
             printf("> LMX2592 Test Board\n");
             printf("> REF CLK = 48 MHz TCXO, 0.5ppm, Fpfd = REF * 5 / 2 = 120 MHz\n");
+            printf("> Firmware build profile: %s\n", BUILD_PROFILE);
             printf("> Frequency range: 20 MHz to 9800 MHz\n");
             printf("> Fundamental (no subharmonics) range: 20 MHz to 7100 MHz. Above that, there will be 1/2 n harmonics due to the doubler.\n");
             printf("> Power draw from USB: ~400 mA\n");
@@ -192,10 +1277,14 @@ void get_inputs() {
             printf("> Unknown command: %s\n> For a list of commands, use -help", argv[i]);
         }
     }
+    sched_release();
 }
 
 int main() {
+    board_init_clocks();
     
+    // with TinyUSB linked in directly (for the bulk interface), stdio expects it to be up already
+    tusb_init();
     stdio_init_all(); // for printf
 
     gpio_init(25);
@@ -210,11 +1299,21 @@ int main() {
 
     sleep_ms(100);
     //printf("he;;p wprld\n");
-    pll.init_spi();
-    pll.set_frequency(1'100'000'000);
-    pll.set_power_int(0);
-    pll.enable_rf1(0);
-    pll.enable_rf2(0);
+    for (int i = 0; i < NUM_PLLS; i++)
+        all_plls[i] = &plls[i];
+    LMX2592::init_all(all_plls, NUM_PLLS);
+    for (int i = 0; i < NUM_PLLS; i++) {
+        lmx2592_link_result results[LMX2592::MAX_LINK_RATES];
+        int num_results;
+        uint32_t baud = plls[i].train_spi(results, &num_results);
+        // nobody is listening yet, the log holds on to these until the console is up
+        for (int r = 0; r < num_results; r++)
+            log_event(LOG_INFO, EV_LINK_RATE, i, (int32_t) results[r].baud, results[r].errors);
+        log_event(LOG_INFO, EV_LINK_TRAINED, i, (int32_t) baud);
+    }
+    load_boot_state();
+    LMX2592::lock_wait_gap = sched_yield;
+    sched_init();
 
     while(1) { // rekt noob timeam
         get_inputs();
@@ -0,0 +1,253 @@
+#include "scheduler.h"
+#include "lmx2592.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+static sched_entry entries[SCHED_SIZE];
+// free slots of entries[], as a stack
+static uint16_t free_slots[SCHED_SIZE];
+static int num_free = 0;
+// queued slots latest first, so the next one due is at the end and comes off without moving anything
+static uint16_t order[SCHED_SIZE];
+static volatile int num_queued = 0;
+
+static sched_result results[SCHED_LOG_SIZE];
+static volatile uint32_t results_head = 0;
+
+static int alarm_num = -1;
+static uint32_t next_id = 1;
+static volatile int hold_depth = 0;
+static volatile bool deferred_pending = false;
+
+volatile uint32_t sched_executed = 0;
+volatile uint32_t sched_deferred = 0;
+volatile int32_t sched_max_late_us = 0;
+
+static void LMX_HOT(execute)(const sched_entry& entry) {
+    const uint16_t* regfile = entry.dev->get_regfile();
+    if (entry.op == SCHED_FREQ) {
+        uint16_t values[LMX2592PlanTable::NUM_APPLY_REGS];
+        for (int k = 0; k < LMX2592PlanTable::NUM_APPLY_REGS; k++)
+            values[k] = LMX2592PlanTable::merge_device_bits(LMX2592PlanTable::APPLY_REGS[k], entry.values[k], regfile);
+        entry.dev->apply_registers_irq(LMX2592PlanTable::APPLY_REGS, values, LMX2592PlanTable::NUM_APPLY_REGS);
+    }
+    else {
+        static constexpr uint8_t addresses[2] = {47, 46};
+        uint16_t values[2];
+        for (int k = 0; k < 2; k++)
+            values[k] = (regfile[addresses[k]] & ~entry.mask[k]) | entry.bits[k];
+        entry.dev->write_registers(addresses, values, 2);
+    }
+}
+
+// points the alarm at the next deadline. true if that is already close enough to run now
+static bool LMX_HOT(arm_next)() {
+    if (num_queued == 0) return false;
+    uint64_t wake = entries[order[num_queued - 1]].time_us - SCHED_LEAD_US;
+    if (wake <= time_us_64()) return true;
+    // set_target() says when the time went by while it was being set
+    return hardware_alarm_set_target(alarm_num, from_us_since_boot(wake));
+}
+
+// for work that is already due: the SDK only calls back for an alarm that is armed, so arm one just ahead
+static void fire_soon() {
+    uint32_t delay = 2;
+    while (hardware_alarm_set_target(alarm_num, from_us_since_boot(time_us_64() + delay)))
+        delay *= 2;
+}
+
+// executes everything that is due, from the alarm interrupt or (with interrupts off) for a thread letting go of a hold
+static void LMX_HOT(run_due)() {
+    bool late_start = deferred_pending;
+    deferred_pending = false;
+    uint64_t entered = time_us_64();
+    while (arm_next()) {
+        uint16_t slot = order[num_queued - 1];
+        num_queued = num_queued - 1;
+        const sched_entry& entry = entries[slot];
+        busy_wait_until(from_us_since_boot(entry.time_us));
+        int32_t late = (int32_t) (time_us_64() - entry.time_us);
+        execute(entry);
+
+        sched_result& result = results[results_head & (SCHED_LOG_SIZE - 1)];
+        result.time_us = entry.time_us;
+        result.dev = entry.dev;
+        result.id = entry.id;
+        result.op = entry.op;
+        result.deferred = late_start && entry.time_us <= entered + SCHED_LEAD_US;
+        result.late_us = late;
+        results_head = results_head + 1;
+        sched_executed = sched_executed + 1;
+        if (result.deferred) sched_deferred = sched_deferred + 1;
+        if (late > sched_max_late_us) sched_max_late_us = late;
+        free_slots[num_free++] = slot;
+    }
+}
+
+static void LMX_HOT(alarm_irq)(uint alarm) {
+    if (hold_depth > 0) {
+        // the thread is in the middle of the driver, it runs these itself once it lets go
+        deferred_pending = true;
+        return;
+    }
+    run_due();
+}
+
+// what came due during a hold goes out straight away, rather than on an alarm the thread might be back in the
+// driver for
+static void run_deferred() {
+    if (!deferred_pending || alarm_num < 0) return;
+    uint32_t irq = save_and_disable_interrupts();
+    run_due();
+    restore_interrupts(irq);
+}
+
+void sched_init() {
+    if (alarm_num >= 0) return;
+    alarm_num = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(alarm_num, &alarm_irq);
+    sched_clear();
+}
+
+// takes a free slot, filled in apart from the time and id. nullptr when the queue is full
+static sched_entry* new_entry(LMX2592* dev, sched_op op) {
+    uint32_t irq = save_and_disable_interrupts();
+    int slot = (num_free > 0) ? free_slots[--num_free] : -1;
+    restore_interrupts(irq);
+    if (slot < 0) return nullptr;
+    sched_entry* entry = &entries[slot];
+    entry->dev = dev;
+    entry->op = op;
+    entry->freq_hz = 0;
+    return entry;
+}
+
+// hands an unqueued entry back
+static void drop_entry(sched_entry* entry) {
+    uint32_t irq = save_and_disable_interrupts();
+    free_slots[num_free++] = (uint16_t) (entry - entries);
+    restore_interrupts(irq);
+}
+
+static int submit(sched_entry* entry, uint64_t time_us) {
+    uint32_t irq = save_and_disable_interrupts();
+    if (time_us <= time_us_64() + SCHED_LEAD_US) {
+        free_slots[num_free++] = (uint16_t) (entry - entries);
+        restore_interrupts(irq);
+        return SCHED_ERR_PAST;
+    }
+    entry->time_us = time_us;
+    entry->id = next_id++;
+    uint16_t slot = (uint16_t) (entry - entries);
+
+    // after everything due later, and after anything due at the same time, which was queued first
+    int lo = 0;
+    int hi = num_queued;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (entries[order[mid]].time_us > time_us) lo = mid + 1;
+        else hi = mid;
+    }
+    for (int k = num_queued; k > lo; k--)
+        order[k] = order[k - 1];
+    order[lo] = slot;
+    num_queued = num_queued + 1;
+
+    if (lo == num_queued - 1 && arm_next())
+        fire_soon();
+    int id = (int) entry->id;
+    restore_interrupts(irq);
+    return id;
+}
+
+int sched_frequency(LMX2592* dev, uint64_t time_us, double freq_hz) {
+    sched_entry* entry = new_entry(dev, SCHED_FREQ);
+    if (entry == nullptr) return SCHED_ERR_FULL;
+    uint16_t image[71];
+    if (!dev->plan_image(freq_hz, image)) {
+        drop_entry(entry);
+        return SCHED_ERR_RANGE;
+    }
+    for (int k = 0; k < LMX2592PlanTable::NUM_APPLY_REGS; k++)
+        entry->values[k] = image[LMX2592PlanTable::APPLY_REGS[k]];
+    entry->freq_hz = freq_hz;
+    return submit(entry, time_us);
+}
+
+int sched_power(LMX2592* dev, uint64_t time_us, uint16_t power) {
+    if (power > 47) return SCHED_ERR_RANGE;
+    // the same gap set_power_int() skips: 32 to 47 are register values 48 to 63
+    if (power > 31) power = 48 + (power - 32);
+    sched_entry* entry = new_entry(dev, SCHED_POWER);
+    if (entry == nullptr) return SCHED_ERR_FULL;
+    entry->mask[0] = 0x003f; // R47 OUTB_POW
+    entry->bits[0] = power;
+    entry->mask[1] = 0x3f00; // R46 OUTA_POW
+    entry->bits[1] = (uint16_t) (power << 8);
+    return submit(entry, time_us);
+}
+
+int sched_output(LMX2592* dev, uint64_t time_us, sched_op output, bool enabled) {
+    if (output != SCHED_RF1 && output != SCHED_RF2) return SCHED_ERR_RANGE;
+    sched_entry* entry = new_entry(dev, output);
+    if (entry == nullptr) return SCHED_ERR_FULL;
+    // R46 OUTA_PD / OUTB_PD
+    uint16_t pd_bit = (output == SCHED_RF1) ? 0x0040 : 0x0080;
+    entry->mask[0] = 0;
+    entry->bits[0] = 0;
+    entry->mask[1] = pd_bit;
+    entry->bits[1] = enabled ? 0 : pd_bit;
+    return submit(entry, time_us);
+}
+
+void sched_clear() {
+    uint32_t irq = save_and_disable_interrupts();
+    if (alarm_num >= 0) hardware_alarm_cancel(alarm_num);
+    num_queued = 0;
+    for (int k = 0; k < SCHED_SIZE; k++)
+        free_slots[k] = (uint16_t) (SCHED_SIZE - 1 - k);
+    num_free = SCHED_SIZE;
+    results_head = 0;
+    sched_executed = 0;
+    sched_deferred = 0;
+    sched_max_late_us = 0;
+    deferred_pending = false;
+    restore_interrupts(irq);
+}
+
+int sched_pending() {
+    return num_queued;
+}
+
+void sched_hold() {
+    hold_depth = hold_depth + 1;
+}
+
+void sched_release() {
+    hold_depth = hold_depth - 1;
+    if (hold_depth == 0) run_deferred();
+}
+
+int sched_suspend() {
+    int depth = hold_depth;
+    hold_depth = 0;
+    run_deferred();
+    return depth;
+}
+
+void sched_resume(int depth) {
+    hold_depth = depth;
+}
+
+void sched_yield() {
+    sched_resume(sched_suspend());
+}
+
+int sched_snapshot(sched_result* out, int max_results) {
+    uint32_t head = results_head;
+    uint32_t count = head < SCHED_LOG_SIZE ? head : SCHED_LOG_SIZE;
+    if (count > (uint32_t) max_results) count = (uint32_t) max_results;
+    for (uint32_t k = 0; k < count; k++)
+        out[k] = results[(head - count + k) & (SCHED_LOG_SIZE - 1)];
+    return (int) count;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "pico/stdlib.h"
+#include "lmx2592_plan.h"
+
+class LMX2592;
+
+// time-tagged commands: settings that go out at an absolute time on the 64-bit microsecond timer (time_us_64()),
+// fired from a hardware alarm interrupt. everything is worked out when the command is queued, so the interrupt only
+// merges the precomputed registers with the device's current ones and writes them. a retune's lock wait is left to
+// LMX2592::service_retune() in the idle loop
+enum sched_op : uint8_t {
+    SCHED_FREQ = 0,
+    SCHED_POWER,
+    SCHED_RF1,
+    SCHED_RF2,
+};
+
+static constexpr int SCHED_SIZE = 256;     // queued commands
+static constexpr int SCHED_LOG_SIZE = 256; // executed commands kept for -sched log, power of two
+// the alarm goes off this much before a deadline and the interrupt spins for the rest, so interrupt entry doesn't
+// count against the timing
+static constexpr uint32_t SCHED_LEAD_US = 4;
+
+// submit errors
+static constexpr int SCHED_ERR_FULL = -1;
+static constexpr int SCHED_ERR_PAST = -2;
+static constexpr int SCHED_ERR_RANGE = -3;
+
+struct sched_entry {
+    uint64_t time_us;
+    LMX2592* dev;
+    uint32_t id;
+    sched_op op;
+    double freq_hz; // SCHED_FREQ, for the record only
+    // SCHED_FREQ: the planned image's APPLY_REGS, applied like a hop plan
+    uint16_t values[LMX2592PlanTable::NUM_APPLY_REGS];
+    // everything else: bits to set in R46 and R47, the rest of both is left as it is
+    uint16_t mask[2];
+    uint16_t bits[2];
+};
+
+// one executed command
+struct sched_result {
+    uint64_t time_us; // when it was due
+    LMX2592* dev;
+    uint32_t id;
+    sched_op op;
+    bool deferred;   // the bus was busy at the deadline
+    int32_t late_us; // from the deadline to the first frame
+};
+
+extern volatile uint32_t sched_executed;
+extern volatile uint32_t sched_deferred;
+extern volatile int32_t sched_max_late_us;
+
+// claims a hardware alarm. call once before queueing anything
+void sched_init();
+// each returns the command's id (counting up from 1), or a SCHED_ERR_. time_us must still be ahead. plans are taken
+// against dev as it is now, and only written when they come due
+int sched_frequency(LMX2592* dev, uint64_t time_us, double freq_hz);
+int sched_power(LMX2592* dev, uint64_t time_us, uint16_t power);
+int sched_output(LMX2592* dev, uint64_t time_us, sched_op output, bool enabled);
+// drops everything queued, the log and the counters
+void sched_clear();
+int sched_pending();
+// the thread holds the scheduler while it uses the driver itself, commands coming due meanwhile wait for
+// sched_release() and count as deferred. nests. a hold should only cover driver calls, never a wait
+void sched_hold();
+void sched_release();
+// for a thread about to wait inside a hold: lets go of it completely (running anything held back) until
+// sched_resume() is given the depth back
+int sched_suspend();
+void sched_resume(int depth);
+// runs anything held back now, for a thread under a hold with nothing half done on any device (between the polls
+// of a lock wait)
+void sched_yield();
+// copies out the newest results (oldest first), returns how many
+int sched_snapshot(sched_result* results, int max_results);
@@ -0,0 +1,259 @@
+#include "scpi.h"
+#include "lmx2592.h"
+#include "ctype.h"
+#include "string.h"
+#include <cstdlib>
+
+// a header node matches either the short form (the leading capitals of mnemonic) or the whole mnemonic
+static bool match_mnemonic(const char* node, int len, const char* mnemonic) {
+    int short_len = 0;
+    while (isupper((unsigned char) mnemonic[short_len])) short_len++;
+    int long_len = strlen(mnemonic);
+    if (len != short_len && len != long_len) return false;
+    for (int i = 0; i < len; i++) {
+        if (toupper((unsigned char) node[i]) != toupper((unsigned char) mnemonic[i])) return false;
+    }
+    return true;
+}
+
+static bool match_word(const char* start, const char* end, const char* word) {
+    int len = end - start;
+    if (len != (int) strlen(word)) return false;
+    for (int i = 0; i < len; i++) {
+        if (toupper((unsigned char) start[i]) != word[i]) return false;
+    }
+    return true;
+}
+
+void ScpiQueue::clear() {
+    head = 0;
+    count = 0;
+}
+
+void ScpiQueue::pop() {
+    if (count == 0) return;
+    head = (head + 1) % QUEUE_SIZE;
+    count--;
+}
+
+void ScpiQueue::push_error(int code) {
+    if (error_count == ERROR_QUEUE_SIZE) {
+        // the newest entry becomes the overflow marker, as the standard asks
+        errors[(error_head + ERROR_QUEUE_SIZE - 1) % ERROR_QUEUE_SIZE] = SCPI_ERR_QUEUE_OVERFLOW;
+        return;
+    }
+    errors[(error_head + error_count) % ERROR_QUEUE_SIZE] = code;
+    error_count++;
+}
+
+int ScpiQueue::pop_error() {
+    if (error_count == 0) return SCPI_NO_ERROR;
+    int code = errors[error_head];
+    error_head = (error_head + 1) % ERROR_QUEUE_SIZE;
+    error_count--;
+    return code;
+}
+
+const char* ScpiQueue::error_message(int code) {
+    switch (code) {
+        case SCPI_NO_ERROR: return "No error";
+        case SCPI_ERR_COMMAND: return "Command error";
+        case SCPI_ERR_INVALID_CHARACTER: return "Invalid character";
+        case SCPI_ERR_PARAM_NOT_ALLOWED: return "Parameter not allowed";
+        case SCPI_ERR_MISSING_PARAM: return "Missing parameter";
+        case SCPI_ERR_UNDEFINED_HEADER: return "Undefined header";
+        case SCPI_ERR_HEADER_SUFFIX: return "Header suffix out of range";
+        case SCPI_ERR_SUFFIX: return "Invalid suffix";
+        case SCPI_ERR_DATA_OUT_OF_RANGE: return "Data out of range";
+        case SCPI_ERR_ILLEGAL_PARAM: return "Illegal parameter value";
+        case SCPI_ERR_DEVICE: return "Device-specific error;PLL did not lock";
+        case SCPI_ERR_QUEUE_OVERFLOW: return "Queue overflow";
+        default: return "Unknown error";
+    }
+}
+
+int ScpiQueue::feed_line(const char* line) {
+    int queued = 0;
+    const char* start = line;
+    while (true) {
+        const char* end = start;
+        while (*end && *end != ';' && *end != '\r' && *end != '\n') end++;
+        // skip empty commands, e.g. a trailing ';'
+        const char* p = start;
+        while (p < end && isspace((unsigned char) *p)) p++;
+        if (p < end && parse_command(p, end)) queued++;
+        if (*end != ';') break;
+        start = end + 1;
+    }
+    return queued;
+}
+
+bool ScpiQueue::parse_command(const char* start, const char* end) {
+    if (count == QUEUE_SIZE) {
+        push_error(SCPI_ERR_QUEUE_OVERFLOW);
+        return false;
+    }
+    scpi_command cmd = {};
+
+    const char* header_end = start;
+    while (header_end < end && !isspace((unsigned char) *header_end)) header_end++;
+    const char* param = header_end;
+    while (param < end && isspace((unsigned char) *param)) param++;
+    const char* param_end = end;
+    while (param_end > param && isspace((unsigned char) param_end[-1])) param_end--;
+
+    if (header_end[-1] == '?') {
+        cmd.query = true;
+        header_end--;
+    }
+
+    if (*start == '*') {
+        if (match_word(start, header_end, "*IDN") && cmd.query) cmd.id = SCPI_IDN;
+        else if (match_word(start, header_end, "*OPC") && cmd.query) cmd.id = SCPI_OPC;
+        else if (match_word(start, header_end, "*RST") && !cmd.query) cmd.id = SCPI_RST;
+        else if (match_word(start, header_end, "*CLS") && !cmd.query) cmd.id = SCPI_CLS;
+        else {
+            push_error(SCPI_ERR_UNDEFINED_HEADER);
+            return false;
+        }
+        if (param != param_end) {
+            push_error(SCPI_ERR_PARAM_NOT_ALLOWED);
+            return false;
+        }
+        queue[(head + count) % QUEUE_SIZE] = cmd;
+        count++;
+        return true;
+    }
+
+    // split the header into nodes, each with an optional numeric suffix
+    const int MAX_NODES = 4;
+    const char* nodes[MAX_NODES];
+    int lengths[MAX_NODES];
+    int suffixes[MAX_NODES];
+    int num_nodes = 0;
+    const char* p = start;
+    if (*p == ':') p++;
+    while (p < header_end) {
+        const char* node_end = p;
+        while (node_end < header_end && *node_end != ':') node_end++;
+        if (num_nodes == MAX_NODES || node_end == p) {
+            push_error(SCPI_ERR_UNDEFINED_HEADER);
+            return false;
+        }
+        const char* digits = node_end;
+        while (digits > p && isdigit((unsigned char) digits[-1])) digits--;
+        nodes[num_nodes] = p;
+        lengths[num_nodes] = digits - p;
+        // saturates rather than overflows, anything that long is out of range anyway
+        int suffix = (digits < node_end) ? 0 : -1;
+        for (const char* d = digits; d < node_end; d++)
+            suffix = (suffix > 9999) ? suffix : suffix * 10 + (*d - '0');
+        suffixes[num_nodes] = suffix;
+        num_nodes++;
+        p = (node_end < header_end) ? node_end + 1 : node_end;
+    }
+
+    if (num_nodes == 0) {
+        push_error(SCPI_ERR_UNDEFINED_HEADER);
+        return false;
+    }
+    int first = 0;
+    if (num_nodes > 1 && match_mnemonic(nodes[0], lengths[0], "SOURce")) first++;
+    int remaining = num_nodes - first;
+    const char* root = nodes[first];
+    int root_len = lengths[first];
+    // the optional trailing node each command may carry
+    const char* leaf = (remaining > 1) ? nodes[first + 1] : nullptr;
+    int leaf_len = (remaining > 1) ? lengths[first + 1] : 0;
+
+    if (remaining >= 1 && remaining <= 2 && match_mnemonic(root, root_len, "FREQuency") &&
+        (!leaf || match_mnemonic(leaf, leaf_len, "CW") || match_mnemonic(leaf, leaf_len, "FIXed"))) {
+        cmd.id = SCPI_FREQ;
+    }
+    else if (remaining >= 1 && remaining <= 2 && match_mnemonic(root, root_len, "POWer") &&
+        (!leaf || match_mnemonic(leaf, leaf_len, "LEVel"))) {
+        cmd.id = SCPI_POW;
+    }
+    else if (first == 0 && remaining >= 1 && remaining <= 2 && match_mnemonic(root, root_len, "OUTPut") &&
+        (!leaf || match_mnemonic(leaf, leaf_len, "STATe"))) {
+        cmd.id = SCPI_OUTP;
+        int channel = (suffixes[0] < 0) ? 1 : suffixes[0];
+        if (channel < 1 || channel > 2) {
+            push_error(SCPI_ERR_HEADER_SUFFIX);
+            return false;
+        }
+        cmd.channel = (uint8_t) channel;
+    }
+    else if (first == 0 && remaining >= 2 && remaining <= 3 && match_mnemonic(root, root_len, "SYSTem") &&
+        match_mnemonic(nodes[1], lengths[1], "ERRor") && cmd.query &&
+        (remaining == 2 || match_mnemonic(nodes[2], lengths[2], "NEXT"))) {
+        cmd.id = SCPI_SYST_ERR;
+    }
+    else {
+        push_error(SCPI_ERR_UNDEFINED_HEADER);
+        return false;
+    }
+    for (int n = (cmd.id == SCPI_OUTP) ? 1 : 0; n < num_nodes; n++) {
+        if (suffixes[n] >= 0) {
+            push_error(SCPI_ERR_HEADER_SUFFIX);
+            return false;
+        }
+    }
+
+    if (cmd.query) {
+        if (param != param_end) {
+            push_error(SCPI_ERR_PARAM_NOT_ALLOWED);
+            return false;
+        }
+    }
+    else if (param == param_end) {
+        push_error(SCPI_ERR_MISSING_PARAM);
+        return false;
+    }
+    else if (cmd.id == SCPI_OUTP) {
+        if (match_word(param, param_end, "ON") || match_word(param, param_end, "1")) cmd.value = 1;
+        else if (match_word(param, param_end, "OFF") || match_word(param, param_end, "0")) cmd.value = 0;
+        else {
+            push_error(SCPI_ERR_ILLEGAL_PARAM);
+            return false;
+        }
+    }
+    else {
+        char* number_end;
+        cmd.value = strtod(param, &number_end);
+        if (number_end == param) {
+            push_error(SCPI_ERR_ILLEGAL_PARAM);
+            return false;
+        }
+        const char* unit = number_end;
+        while (unit < param_end && isspace((unsigned char) *unit)) unit++;
+        if (cmd.id == SCPI_FREQ) {
+            if (unit == param_end || match_word(unit, param_end, "HZ")) {}
+            else if (match_word(unit, param_end, "KHZ")) cmd.value *= 1e3;
+            else if (match_word(unit, param_end, "MHZ")) cmd.value *= 1e6;
+            else if (match_word(unit, param_end, "GHZ")) cmd.value *= 1e9;
+            else {
+                push_error(SCPI_ERR_SUFFIX);
+                return false;
+            }
+            if (!(cmd.value >= LMX2592::OUT_MIN_HZ && cmd.value <= LMX2592::OUT_MAX_HZ)) {
+                push_error(SCPI_ERR_DATA_OUT_OF_RANGE);
+                return false;
+            }
+        }
+        else {
+            if (unit != param_end) {
+                push_error(SCPI_ERR_SUFFIX);
+                return false;
+            }
+            if (!(cmd.value >= 0 && cmd.value <= 47) || cmd.value != (int) cmd.value) {
+                push_error(SCPI_ERR_DATA_OUT_OF_RANGE);
+                return false;
+            }
+        }
+    }
+
+    queue[(head + count) % QUEUE_SIZE] = cmd;
+    count++;
+    return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// SCPI subset for bench automation. lines are parsed into a queue of commands as they arrive, and main.cpp runs them
+// in order from the idle loop, so a host can send a whole batch of settings without waiting on each reply
+//
+//   [SOURce:]FREQuency[:CW] <value>[HZ/KHZ/MHZ/GHZ] / ?   output frequency, Hz by default
+//   [SOURce:]POWer[:LEVel] <0-47> / ?                    the board's power setting, same scale as -p
+//   OUTPut[1/2][:STATe] ON/OFF/1/0 / ?                   RF1 / RF2 enable
+//   SYSTem:ERRor[:NEXT]?                                  pops the error queue
+//   *IDN?  *RST  *CLS  *OPC?                              *OPC? answers 1 once the synthesizers report lock
+//
+// several commands can share a line, separated by ';'. headers are case insensitive, short or long form
+enum scpi_command_id {
+    SCPI_FREQ,
+    SCPI_POW,
+    SCPI_OUTP,
+    SCPI_SYST_ERR,
+    SCPI_IDN,
+    SCPI_RST,
+    SCPI_CLS,
+    SCPI_OPC,
+};
+
+struct scpi_command {
+    uint8_t id;      // scpi_command_id
+    bool query;
+    uint8_t channel; // OUTPut suffix
+    double value;
+};
+
+// SCPI standard error numbers
+enum scpi_error {
+    SCPI_NO_ERROR = 0,
+    SCPI_ERR_COMMAND = -100,
+    SCPI_ERR_INVALID_CHARACTER = -101,
+    SCPI_ERR_PARAM_NOT_ALLOWED = -108,
+    SCPI_ERR_MISSING_PARAM = -109,
+    SCPI_ERR_UNDEFINED_HEADER = -113,
+    SCPI_ERR_HEADER_SUFFIX = -114,
+    SCPI_ERR_SUFFIX = -131,
+    SCPI_ERR_DATA_OUT_OF_RANGE = -222,
+    SCPI_ERR_ILLEGAL_PARAM = -224,
+    SCPI_ERR_DEVICE = -300, // used for lock timeouts
+    SCPI_ERR_QUEUE_OVERFLOW = -350,
+};
+
+class ScpiQueue {
+public:
+    static constexpr int QUEUE_SIZE = 64;
+    static constexpr int ERROR_QUEUE_SIZE = 16;
+
+    // splits a line into commands and queues them, errors go to the error queue. returns how many were queued.
+    // a line of n characters holds at most (n + 1) / 2 commands, check free() first
+    int feed_line(const char* line);
+    int free() { return QUEUE_SIZE - count; }
+    bool empty() { return count == 0; }
+    scpi_command* front() { return &queue[head]; }
+    void pop();
+    void clear();
+
+    void push_error(int code);
+    // oldest error first, SCPI_NO_ERROR when there are none
+    int pop_error();
+    void clear_errors() { error_count = 0; }
+    static const char* error_message(int code);
+
+private:
+    scpi_command queue[QUEUE_SIZE];
+    int head = 0;
+    int count = 0;
+    int16_t errors[ERROR_QUEUE_SIZE];
+    int error_head = 0;
+    int error_count = 0;
+
+    bool parse_command(const char* start, const char* end);
+};
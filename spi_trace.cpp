@@ -0,0 +1,78 @@
+#include "spi_trace.h"
+#include "lmx2592.h"
+#include "stdio.h"
+
+spi_trace_entry spi_trace_buf[SPI_TRACE_SIZE];
+volatile uint32_t spi_trace_head = 0;
+volatile bool spi_trace_enabled = false;
+
+void spi_trace_clear() {
+    spi_trace_head = 0;
+}
+
+int spi_trace_snapshot(spi_trace_entry* entries, int max_entries) {
+    uint32_t head = spi_trace_head;
+    uint32_t count = head < SPI_TRACE_SIZE ? head : SPI_TRACE_SIZE;
+    if (count > (uint32_t) max_entries) count = max_entries;
+    for (uint32_t i = 0; i < count; i++) {
+        entries[i] = spi_trace_buf[(head - count + i) & (SPI_TRACE_SIZE - 1)];
+    }
+    return count;
+}
+
+void spi_trace_dump() {
+    // stop recording so the dump itself can't overwrite what we're printing
+    bool was_enabled = spi_trace_enabled;
+    spi_trace_enabled = false;
+
+    uint32_t head = spi_trace_head;
+    uint32_t count = head < SPI_TRACE_SIZE ? head : SPI_TRACE_SIZE;
+    // one line per frame: time_us,cs,R/W,address,data,gap since previous frame
+    printf("> trace: %d frames (%d recorded)\n", (int) count, (int) head);
+    uint32_t prev_time = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const spi_trace_entry& e = spi_trace_buf[(head - count + i) & (SPI_TRACE_SIZE - 1)];
+        uint32_t gap = (i == 0) ? 0 : e.time_us - prev_time;
+        prev_time = e.time_us;
+        printf("%u,%d,%c,%d,0x%04x,%u\n", (unsigned) e.time_us, e.cs, (e.address & 0x80) ? 'R' : 'W',
+            e.address & 0x7f, e.data, (unsigned) gap);
+    }
+    spi_trace_enabled = was_enabled;
+}
+
+int spi_trace_replay(LMX2592* const* devs, int count, uint32_t* max_late_us) {
+    static spi_trace_entry entries[SPI_TRACE_SIZE];
+    int num_entries = spi_trace_snapshot(entries, SPI_TRACE_SIZE);
+
+    bool was_enabled = spi_trace_enabled;
+    spi_trace_enabled = false;
+
+    int sent = 0;
+    *max_late_us = 0;
+    uint32_t first_time = 0;
+    uint64_t start = time_us_64() + 1000; // a little headroom so the first frame isn't already late
+    for (int i = 0; i < num_entries; i++) {
+        const spi_trace_entry& e = entries[i];
+        if (e.address & 0x80) continue;
+        LMX2592* dev = nullptr;
+        for (int d = 0; d < count; d++) {
+            if (devs[d]->get_cs_pin() == e.cs) dev = devs[d];
+        }
+        if (dev == nullptr) continue;
+
+        if (sent == 0) first_time = e.time_us;
+        uint64_t deadline = start + (uint32_t) (e.time_us - first_time);
+        uint64_t now = time_us_64();
+        if (now < deadline) {
+            busy_wait_until(from_us_since_boot(deadline));
+        }
+        else if (now - deadline > *max_late_us) {
+            *max_late_us = (uint32_t) (now - deadline);
+        }
+        dev->spi_write24(e.address, e.data);
+        sent++;
+    }
+
+    spi_trace_enabled = was_enabled;
+    return sent;
+}
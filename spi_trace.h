@@ -0,0 +1,43 @@
+#pragma once
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+class LMX2592;
+
+// one SPI frame as the driver sent (or read) it
+struct spi_trace_entry {
+    uint32_t time_us; // low word of the hardware timer, good for ~71 minutes of relative timing
+    uint8_t cs;       // CS pin of the device, identifies which synthesizer it went to
+    uint8_t address;  // bit 7 set for reads, like on the wire
+    uint16_t data;
+};
+
+static constexpr uint32_t SPI_TRACE_SIZE = 1024; // power of two
+
+extern spi_trace_entry spi_trace_buf[SPI_TRACE_SIZE];
+extern volatile uint32_t spi_trace_head;
+extern volatile bool spi_trace_enabled;
+
+// called for every frame, so it has to stay cheap: a slot is claimed with interrupts masked for the increment
+// only (frames can come from IRQ context too), then filled in. the reader never holds the writers up
+static inline void spi_trace_record(uint8_t cs, uint8_t address, uint16_t data) {
+    if (!spi_trace_enabled) return;
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t slot = spi_trace_head;
+    spi_trace_head = slot + 1;
+    restore_interrupts(irq);
+    spi_trace_entry& entry = spi_trace_buf[slot & (SPI_TRACE_SIZE - 1)];
+    entry.time_us = time_us_32();
+    entry.cs = cs;
+    entry.address = address;
+    entry.data = data;
+}
+
+void spi_trace_clear();
+// copies out the newest entries (oldest first), returns how many
+int spi_trace_snapshot(spi_trace_entry* entries, int max_entries);
+void spi_trace_dump();
+// re-issues the captured writes to the matching devices with their original spacing. reads are skipped.
+// returns how many frames went out, and the worst lateness against the original timing
+int spi_trace_replay(LMX2592* const* devs, int count, uint32_t* max_late_us);
@@ -0,0 +1,60 @@
+#include "ticspro_import.h"
+#include "ctype.h"
+
+void TicsProImport::reset() {
+    for (int i = 0; i < 71; i++) {
+        image[i] = 0;
+        present[i] = false;
+    }
+    registers = 0;
+    errors = 0;
+}
+
+TicsProImport::status TicsProImport::feed_line(const char* line) {
+    while (isspace((unsigned char) *line)) line++;
+    if (*line == 0) return LINE_SKIPPED;
+    if (*line != 'R' && *line != 'r') return LINE_SKIPPED;
+    line++;
+
+    if (!isdigit((unsigned char) *line)) {
+        errors++;
+        return LINE_BAD_FORMAT;
+    }
+    int label = 0;
+    while (isdigit((unsigned char) *line)) {
+        label = label * 10 + (*line - '0');
+        line++;
+    }
+
+    while (isspace((unsigned char) *line)) line++;
+    if (line[0] != '0' || (line[1] != 'x' && line[1] != 'X')) {
+        errors++;
+        return LINE_BAD_FORMAT;
+    }
+    line += 2;
+
+    // 8 address bits and 16 data bits
+    uint32_t word = 0;
+    int digits = 0;
+    while (isxdigit((unsigned char) *line)) {
+        char c = tolower((unsigned char) *line);
+        word = (word << 4) | (uint32_t) (isdigit((unsigned char) c) ? c - '0' : c - 'a' + 10);
+        digits++;
+        line++;
+    }
+    while (isspace((unsigned char) *line)) line++;
+    if (digits == 0 || digits > 6 || *line != 0) {
+        errors++;
+        return LINE_BAD_FORMAT;
+    }
+
+    uint32_t address = word >> 16;
+    if (address > 70 || (int) address != label) {
+        errors++;
+        return LINE_BAD_ADDRESS;
+    }
+    if (!present[address]) registers++;
+    image[address] = (uint16_t) (word & 0xffff);
+    present[address] = true;
+    return LINE_OK;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// incremental parser for TICS Pro register exports, one "R70	0x460000" line at a time
+class TicsProImport {
+public:
+    enum status {
+        LINE_OK,
+        LINE_SKIPPED,     // blank or not a register line (TICS Pro headers and such)
+        LINE_BAD_FORMAT,
+        LINE_BAD_ADDRESS, // out of range, or the Rn label doesn't match the address byte
+    };
+
+    uint16_t image[71];
+    bool present[71];
+    int registers;
+    int errors;
+
+    void reset();
+    status feed_line(const char* line);
+};
@@ -0,0 +1,6 @@
+#pragma once
+#include "pico/stdlib.h"
+
+enum clock_index { clk_gpout0, clk_gpout1, clk_gpout2, clk_gpout3, clk_ref, clk_sys, clk_peri };
+
+uint32_t clock_get_hz(enum clock_index clk_index);
@@ -0,0 +1,52 @@
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "hardware/spi.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "tusb.h"
+#include <chrono>
+
+// no-op stand-ins for the SDK calls the driver sources reference. planning never reaches any of them
+
+struct spi_inst {
+    uint index;
+};
+static spi_inst host_spi[2] = {{0}, {1}};
+spi_inst_t* spi0 = &host_spi[0];
+spi_inst_t* spi1 = &host_spi[1];
+
+uint64_t time_us_64(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+uint32_t time_us_32(void) { return (uint32_t) time_us_64(); }
+void sleep_ms(uint32_t ms) {}
+void sleep_us(uint64_t us) {}
+void busy_wait_us_32(uint32_t us) {}
+void busy_wait_until(absolute_time_t t) {}
+
+void gpio_init(uint gpio) {}
+void gpio_set_dir(uint gpio, bool out) {}
+void gpio_put(uint gpio, bool value) {}
+bool gpio_get(uint gpio) { return false; }
+void gpio_set_function(uint gpio, enum gpio_function fn) {}
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled) {}
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback) {}
+
+uint spi_init(spi_inst_t* spi, uint baudrate) { return baudrate; }
+uint spi_set_baudrate(spi_inst_t* spi, uint baudrate) { return baudrate; }
+uint spi_get_baudrate(const spi_inst_t* spi) { return 0; }
+uint spi_get_index(const spi_inst_t* spi) { return spi->index; }
+void spi_set_format(spi_inst_t* spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order) {}
+int spi_write_blocking(spi_inst_t* spi, const uint8_t* src, size_t len) { return (int) len; }
+int spi_read_blocking(spi_inst_t* spi, uint8_t repeated_tx_data, uint8_t* dst, size_t len) {
+    for (size_t i = 0; i < len; i++) dst[i] = 0;
+    return (int) len;
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) { return 125'000'000; }
+uint32_t save_and_disable_interrupts(void) { return 0; }
+void restore_interrupts(uint32_t status) {}
+
+bool stdio_usb_connected(void) { return true; }
+uint32_t tud_cdc_write_available(void) { return 0; }
@@ -0,0 +1,4 @@
+#pragma once
+#include "pico/stdlib.h"
+
+bool stdio_usb_connected(void);
@@ -0,0 +1,35 @@
+#pragma once
+// just enough of the Pico SDK for the driver sources to build on a host. the plan compiler only ever plans, so
+// nothing here talks to hardware: the bus and GPIO calls are no-ops (host_sdk.cpp)
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#define __not_in_flash_func(func_name) func_name
+#define PICO_ERROR_TIMEOUT -1
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+enum gpio_function { GPIO_FUNC_SPI = 1, GPIO_FUNC_SIO = 5 };
+enum gpio_irq_level { GPIO_IRQ_LEVEL_LOW = 1, GPIO_IRQ_LEVEL_HIGH = 2, GPIO_IRQ_EDGE_FALL = 4, GPIO_IRQ_EDGE_RISE = 8 };
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+static inline absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+void busy_wait_us_32(uint32_t us);
+void busy_wait_until(absolute_time_t t);
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
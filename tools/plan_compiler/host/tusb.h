@@ -0,0 +1,4 @@
+#pragma once
+#include "pico/stdlib.h"
+
+uint32_t tud_cdc_write_available(void);
@@ -0,0 +1,351 @@
+// host-side plan compiler: turns a frequency list into a binary plan table for -plan upload, using the driver's own
+// planner and register packing, so every image matches what the board would compute for the same point
+#include "lmx2592.h"
+#include "lmx2592_plan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <poll.h>
+
+struct plan_point {
+    double target_hz;
+    double actual_hz;
+    bool ok;
+    uint16_t regs[LMX2592PlanTable::NUM_PLAN_REGS]; // PLAN_REGS values, in that order
+};
+
+static void usage() {
+    fprintf(stderr,
+        "Usage: lmx2592_plan_compiler [options] [frequency file]\n"
+        "  -o <file>                      plan table to write (default plans.bin)\n"
+        "  --range <start> <stop> <step>  add points like -plan range, in MHz\n"
+        "  --cal <default/fast>           calibration profile the board runs (default: default)\n"
+        "  --threads <n>                  worker threads (default: all cores)\n"
+        "  --report <file>                per-point CSV, '-' for stdout (default: stdout)\n"
+        "  --verify                       replan every point through the on-device path and check the table loads\n"
+        "  --upload <port>                send the table to the board, e.g. /dev/ttyACM0\n"
+        "The frequency file holds MHz values separated by whitespace or commas, '#' starts a comment.\n");
+}
+
+static bool read_frequency_file(const char* path, std::vector<double>& freqs) {
+    FILE* file = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "error: can't open %s\n", path);
+        return false;
+    }
+    char line[256];
+    int line_number = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment) *comment = 0;
+        char* token = strtok(line, " \t\r\n,");
+        while (token) {
+            char* end;
+            double mhz = strtod(token, &end);
+            if (*end != 0) {
+                fprintf(stderr, "error: %s:%d: bad frequency '%s'\n", path, line_number, token);
+                ok = false;
+            }
+            // the same conversion as the CLI's atof(...) * 1'000'000.0
+            freqs.push_back(mhz * 1'000'000.0);
+            token = strtok(nullptr, " \t\r\n,");
+        }
+    }
+    if (file != stdin) fclose(file);
+    return ok;
+}
+
+// plans points [0, n) on every core. each worker has its own driver instance, the planner keeps state in it
+static void plan_all(std::vector<plan_point>& points, lmx2592_cal_profile profile, int threads, uint16_t* image_out) {
+    const size_t CHUNK = 256;
+    std::atomic<size_t> next(0);
+    auto worker = [&](bool first) {
+        LMX2592 dev(lmx2592_pins{spi0, 0, 0, 0, 0, 0});
+        dev.set_cal_profile(profile);
+        while (true) {
+            size_t start = next.fetch_add(CHUNK);
+            if (start >= points.size()) break;
+            size_t end = std::min(start + CHUNK, points.size());
+            for (size_t i = start; i < end; i++) {
+                plan_point& point = points[i];
+                point.ok = dev.plan_frequency(point.target_hz);
+                if (!point.ok) continue;
+                const uint16_t* regfile = dev.get_regfile();
+                for (int r = 0; r < LMX2592PlanTable::NUM_PLAN_REGS; r++)
+                    point.regs[r] = regfile[LMX2592PlanTable::PLAN_REGS[r]];
+                point.actual_hz = dev.output_from_config();
+            }
+        }
+        if (first) {
+            // the registers no plan touches, for the base image
+            dev.plan_frequency(1'100'000'000.0);
+            memcpy(image_out, dev.get_regfile(), 71 * sizeof(uint16_t));
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++)
+        pool.emplace_back(worker, false);
+    worker(true);
+    for (std::thread& t : pool)
+        t.join();
+}
+
+static void put16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(value & 0xff);
+    out.push_back(value >> 8);
+}
+
+static void put32(std::vector<uint8_t>& out, uint32_t value) {
+    put16(out, value & 0xffff);
+    put16(out, value >> 16);
+}
+
+// waits up to timeout_ms for a line from the board containing any of the given strings, echoing what comes back
+static bool wait_for_reply(int fd, const char* const* wanted, int num_wanted, int timeout_ms, std::string& reply) {
+    std::string line;
+    while (true) {
+        pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) <= 0) return false;
+        char c;
+        if (read(fd, &c, 1) != 1) return false;
+        if (c != '\n') {
+            if (c != '\r') line += c;
+            continue;
+        }
+        if (!line.empty()) fprintf(stderr, "board: %s\n", line.c_str());
+        for (int w = 0; w < num_wanted; w++) {
+            if (line.find(wanted[w]) != std::string::npos) {
+                reply = line;
+                return true;
+            }
+        }
+        line.clear();
+    }
+}
+
+static bool upload(const char* port, const std::vector<uint8_t>& table) {
+    int fd = open(port, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        fprintf(stderr, "error: can't open %s\n", port);
+        return false;
+    }
+    termios tty;
+    if (tcgetattr(fd, &tty) == 0) {
+        // raw bytes both ways, USB CDC ignores the baud rate
+        cfmakeraw(&tty);
+        tcsetattr(fd, TCSANOW, &tty);
+    }
+    tcflush(fd, TCIOFLUSH);
+
+    std::string reply;
+    const char* READY[] = {"Ready for plan table"};
+    const char* command = "-plan upload\n";
+    bool ok = write(fd, command, strlen(command)) == (ssize_t) strlen(command) &&
+        wait_for_reply(fd, READY, 1, 2000, reply);
+    if (!ok) {
+        fprintf(stderr, "error: no answer to -plan upload\n");
+        close(fd);
+        return false;
+    }
+    size_t sent = 0;
+    while (ok && sent < table.size()) {
+        ssize_t n = write(fd, table.data() + sent, std::min<size_t>(4096, table.size() - sent));
+        ok = n > 0;
+        if (ok) sent += n;
+    }
+    const char* DONE[] = {"> Loaded", "> Error"};
+    ok = ok && wait_for_reply(fd, DONE, 2, 5000, reply) && reply.find("> Loaded") != std::string::npos;
+    close(fd);
+    if (!ok) fprintf(stderr, "error: upload failed\n");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    const char* output_path = "plans.bin";
+    const char* report_path = "-";
+    const char* upload_port = nullptr;
+    lmx2592_cal_profile profile = CAL_DEFAULT;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    bool verify = false;
+    std::vector<double> freqs;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--range") == 0 && i + 3 < argc) {
+            double start = atof(argv[++i]) * 1'000'000.0;
+            double stop = atof(argv[++i]) * 1'000'000.0;
+            double step = atof(argv[++i]) * 1'000'000.0;
+            if (step <= 0.0 || stop < start) {
+                fprintf(stderr, "error: need start <= stop and step > 0\n");
+                return 1;
+            }
+            // stepped exactly like -plan range, so the points come out the same
+            for (double freq = start; freq <= stop; freq += step)
+                freqs.push_back(freq);
+        }
+        else if (strcmp(argv[i], "--cal") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "default") == 0) profile = CAL_DEFAULT;
+            else if (strcmp(argv[i], "fast") == 0) profile = CAL_FAST;
+            else {
+                // seeded picks cores learned at run time, there's nothing to compile for it
+                fprintf(stderr, "error: --cal takes default or fast\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+            report_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--upload") == 0 && i + 1 < argc) {
+            upload_port = argv[++i];
+        }
+        else if (strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != 0) {
+            usage();
+            return 1;
+        }
+        else if (!read_frequency_file(argv[i], freqs)) {
+            return 1;
+        }
+    }
+    if (freqs.empty()) {
+        usage();
+        return 1;
+    }
+
+    std::vector<plan_point> points(freqs.size());
+    for (size_t i = 0; i < freqs.size(); i++)
+        points[i].target_hz = freqs[i];
+    uint16_t base[71];
+    uint64_t start_time = time_us_64();
+    plan_all(points, profile, threads, base);
+    uint64_t plan_time = time_us_64() - start_time;
+
+    // the most common value of each plan register makes the smallest records
+    for (int r = 0; r < LMX2592PlanTable::NUM_PLAN_REGS; r++) {
+        std::map<uint16_t, size_t> counts;
+        for (const plan_point& point : points) {
+            if (point.ok) counts[point.regs[r]]++;
+        }
+        if (counts.empty()) continue;
+        base[LMX2592PlanTable::PLAN_REGS[r]] = std::max_element(counts.begin(), counts.end(),
+            [](const auto& a, const auto& b) { return a.second < b.second; })->first;
+    }
+
+    FILE* report = (strcmp(report_path, "-") == 0) ? stdout : fopen(report_path, "w");
+    if (!report) {
+        fprintf(stderr, "error: can't open %s\n", report_path);
+        return 1;
+    }
+    fprintf(report, "index,target_hz,actual_hz,error_hz,record_bytes\n");
+
+    std::vector<uint8_t> records;
+    uint32_t plans = 0;
+    size_t failed = 0;
+    double worst_error = 0;
+    for (const plan_point& point : points) {
+        if (!point.ok) {
+            fprintf(stderr, "warning: %.6f MHz is out of range, skipped\n", point.target_hz / 1'000'000.0);
+            failed++;
+            continue;
+        }
+        uint16_t image[71];
+        memcpy(image, base, sizeof(image));
+        for (int r = 0; r < LMX2592PlanTable::NUM_PLAN_REGS; r++)
+            image[LMX2592PlanTable::PLAN_REGS[r]] = point.regs[r];
+        uint16_t record[1 + LMX2592PlanTable::NUM_PLAN_REGS];
+        int len = LMX2592PlanTable::encode(base, image, record);
+        for (int w = 0; w < len; w++)
+            put16(records, record[w]);
+
+        double error = point.actual_hz - point.target_hz;
+        worst_error = std::max(worst_error, std::fabs(error));
+        fprintf(report, "%u,%.3f,%.6f,%.6f,%d\n", plans, point.target_hz, point.actual_hz, error, 2 * len);
+        plans++;
+    }
+    if (report != stdout) fclose(report);
+
+    std::vector<uint8_t> table = {'L', 'M', 'X', 'P'};
+    put16(table, LMX2592PlanLoader::VERSION);
+    put16(table, LMX2592PlanTable::NUM_PLAN_REGS);
+    put32(table, plans);
+    put32(table, (uint32_t) (records.size() / 2));
+    for (int r = 0; r < LMX2592PlanTable::NUM_PLAN_REGS; r++)
+        table.push_back(LMX2592PlanTable::PLAN_REGS[r]);
+    for (int i = 0; i < 71; i++)
+        put16(table, base[i]);
+    table.insert(table.end(), records.begin(), records.end());
+    put32(table, LMX2592PlanLoader::crc32(0, table.data(), (int) table.size()));
+
+    FILE* output = fopen(output_path, "wb");
+    if (!output || fwrite(table.data(), 1, table.size(), output) != table.size()) {
+        fprintf(stderr, "error: can't write %s\n", output_path);
+        return 1;
+    }
+    fclose(output);
+
+    fprintf(stderr, "%u plans (%zu out of range) planned on %d threads in %.1f ms\n", plans, failed, threads,
+        plan_time / 1000.0);
+    fprintf(stderr, "%s: %zu bytes, %.1f bytes per plan, worst frequency error %.6f Hz\n", output_path, table.size(),
+        plans ? (double) records.size() / plans : 0.0, worst_error);
+    bool fits = plans <= LMX2592PlanTable::MAX_PLANS && records.size() / 2 <= LMX2592PlanTable::POOL_WORDS;
+    if (!fits) {
+        fprintf(stderr, "warning: the board's table holds %d plans and %d record words, this won't load\n",
+            LMX2592PlanTable::MAX_PLANS, LMX2592PlanTable::POOL_WORDS);
+    }
+
+    if (verify) {
+        // the on-device path: one driver instance, plan_image() from whatever state the last point left
+        LMX2592 dev(lmx2592_pins{spi0, 0, 0, 0, 0, 0});
+        dev.set_cal_profile(profile);
+        size_t mismatches = 0;
+        for (const plan_point& point : points) {
+            uint16_t image[71];
+            bool ok = dev.plan_image(point.target_hz, image);
+            bool same = ok == point.ok;
+            for (int r = 0; same && ok && r < LMX2592PlanTable::NUM_PLAN_REGS; r++)
+                same = image[LMX2592PlanTable::PLAN_REGS[r]] == point.regs[r];
+            if (!same) {
+                if (mismatches < 10)
+                    fprintf(stderr, "verify: %.6f MHz differs from the on-device planner\n", point.target_hz / 1'000'000.0);
+                mismatches++;
+            }
+        }
+        fprintf(stderr, "verify: %zu of %zu images differ from the on-device planner\n", mismatches, points.size());
+
+        if (fits) {
+            static LMX2592PlanTable loaded;
+            LMX2592PlanLoader loader;
+            loader.begin(&loaded);
+            LMX2592PlanLoader::status status = loader.feed(table.data(), (int) table.size());
+            fprintf(stderr, "verify: table %s by the board's loader\n",
+                status == LMX2592PlanLoader::LOAD_DONE ? "accepted" : "rejected");
+            if (status != LMX2592PlanLoader::LOAD_DONE) mismatches++;
+        }
+        if (mismatches) return 1;
+    }
+
+    if (upload_port && !upload(upload_port, table))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// TinyUSB setup for the test board firmware: the CDC console plus the bulk interface (usb_bulk.cpp). the benchmark
+// firmware doesn't see this file and keeps the SDK's CDC-only configuration
+
+#define CFG_TUSB_RHPORT0_MODE   (OPT_MODE_DEVICE)
+
+#define CFG_TUD_ENDPOINT0_SIZE  (64)
+
+#define CFG_TUD_CDC             (1)
+#define CFG_TUD_CDC_RX_BUFSIZE  (256)
+#define CFG_TUD_CDC_TX_BUFSIZE  (256)
+
+// the bulk interface is vendor class, but with our own driver rather than TinyUSB's FIFO based one
+#define CFG_TUD_VENDOR          (0)
@@ -0,0 +1,178 @@
+#include "usb_bulk.h"
+#include "hardware/sync.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "string.h"
+
+volatile uint32_t usb_bulk_rx_bytes = 0;
+volatile uint32_t usb_bulk_tx_bytes = 0;
+volatile uint32_t usb_bulk_tx_dropped = 0;
+
+static uint8_t ep_out = 0;
+static uint8_t ep_in = 0;
+static volatile bool mounted = false;
+
+// OUT buffers are handed out strictly in turn: armed (hardware is filling it), full (waiting for us), or free
+enum rx_state : uint8_t { RX_FREE, RX_ARMED, RX_FULL };
+static uint8_t rx_buf[2][USB_BULK_BUF_SIZE] __attribute__((aligned(4)));
+static volatile rx_state rx_states[2];
+static volatile int rx_len[2];
+static volatile int rx_arm_index = 0;
+static volatile int rx_read_index = 0;
+
+// IN: tx_fill is being written, the other one may be on the bus. only thread context submits (and so swaps them)
+static uint8_t tx_buf[2][USB_BULK_BUF_SIZE] __attribute__((aligned(4)));
+static volatile int tx_len[2];
+static volatile int tx_fill = 0;
+static volatile bool tx_busy = false;
+static volatile bool tx_zlp_pending = false;
+
+static void rx_arm() {
+    // with interrupts off or from the USB task
+    int index = rx_arm_index;
+    if (!mounted || rx_states[index] != RX_FREE || rx_states[index ^ 1] == RX_ARMED) return;
+    rx_states[index] = RX_ARMED;
+    usbd_edpt_xfer(0, ep_out, rx_buf[index], USB_BULK_BUF_SIZE);
+}
+
+static void tx_submit() {
+    int index = tx_fill;
+    if (!mounted || tx_busy || tx_len[index] == 0) return;
+    tx_busy = true;
+    // a transfer that ends on a full packet needs a zero length packet after it, or the host keeps waiting
+    tx_zlp_pending = (tx_len[index] % 64) == 0;
+    usbd_edpt_xfer(0, ep_in, tx_buf[index], tx_len[index]);
+    tx_fill = index ^ 1;
+    tx_len[index ^ 1] = 0;
+}
+
+static void bulk_init() {
+    mounted = false;
+}
+
+static void bulk_reset(uint8_t rhport) {
+    mounted = false;
+    for (int i = 0; i < 2; i++) {
+        rx_states[i] = RX_FREE;
+        tx_len[i] = 0;
+    }
+    rx_arm_index = 0;
+    rx_read_index = 0;
+    tx_fill = 0;
+    tx_busy = false;
+    tx_zlp_pending = false;
+}
+
+static uint16_t bulk_open(uint8_t rhport, tusb_desc_interface_t const* desc, uint16_t max_len) {
+    if (desc->bInterfaceClass != TUSB_CLASS_VENDOR_SPECIFIC || desc->bNumEndpoints != 2) return 0;
+    uint16_t len = sizeof(tusb_desc_interface_t) + 2 * sizeof(tusb_desc_endpoint_t);
+    if (max_len < len) return 0;
+    if (!usbd_open_edpt_pair(rhport, tu_desc_next(desc), 2, TUSB_XFER_BULK, &ep_out, &ep_in)) return 0;
+    mounted = true;
+    rx_arm();
+    return len;
+}
+
+static bool bulk_control_xfer(uint8_t rhport, uint8_t stage, tusb_control_request_t const* request) {
+    return false; // no vendor requests, everything goes over the bulk pipes
+}
+
+static bool bulk_xfer(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+    if (ep_addr == ep_out) {
+        int index = rx_arm_index;
+        rx_len[index] = (int) xferred_bytes;
+        rx_states[index] = RX_FULL;
+        usb_bulk_rx_bytes = usb_bulk_rx_bytes + xferred_bytes;
+        rx_arm_index = index ^ 1;
+        rx_arm();
+    }
+    else if (ep_addr == ep_in) {
+        usb_bulk_tx_bytes = usb_bulk_tx_bytes + xferred_bytes;
+        if (tx_zlp_pending && xferred_bytes > 0) {
+            tx_zlp_pending = false;
+            // the endpoint stays busy until the ZLP completes and calls back here with 0 bytes
+            if (usbd_edpt_xfer(rhport, ep_in, nullptr, 0)) return true;
+        }
+        tx_busy = false;
+    }
+    return true;
+}
+
+static const usbd_class_driver_t bulk_driver = {
+#if CFG_TUSB_DEBUG >= 2
+    .name = "LMX2592 bulk",
+#endif
+    .init = bulk_init,
+    .reset = bulk_reset,
+    .open = bulk_open,
+    .control_xfer_cb = bulk_control_xfer,
+    .xfer_cb = bulk_xfer,
+    .sof = nullptr,
+};
+
+// TinyUSB asks for application class drivers before its own
+usbd_class_driver_t const* usbd_app_driver_get_cb(uint8_t* driver_count) {
+    *driver_count = 1;
+    return &bulk_driver;
+}
+
+bool usb_bulk_mounted() {
+    return mounted;
+}
+
+int usb_bulk_rx_acquire(const uint8_t** data) {
+    int index = rx_read_index;
+    if (rx_states[index] != RX_FULL) return 0;
+    *data = rx_buf[index];
+    return rx_len[index];
+}
+
+void usb_bulk_rx_release() {
+    uint32_t irq_state = save_and_disable_interrupts();
+    int index = rx_read_index;
+    if (rx_states[index] == RX_FULL) {
+        rx_states[index] = RX_FREE;
+        rx_read_index = index ^ 1;
+        rx_arm();
+    }
+    restore_interrupts(irq_state);
+}
+
+uint8_t* usb_bulk_tx_reserve(int len) {
+    if (!mounted || len > USB_BULK_BUF_SIZE) return nullptr;
+    uint32_t irq_state = save_and_disable_interrupts();
+    if (tx_len[tx_fill] + len > USB_BULK_BUF_SIZE) {
+        // this one's full, send it if the other is back
+        tx_submit();
+    }
+    uint8_t* space = nullptr;
+    if (tx_len[tx_fill] + len <= USB_BULK_BUF_SIZE)
+        space = &tx_buf[tx_fill][tx_len[tx_fill]];
+    else
+        usb_bulk_tx_dropped = usb_bulk_tx_dropped + 1;
+    restore_interrupts(irq_state);
+    return space;
+}
+
+void usb_bulk_tx_commit(int len) {
+    // the fill buffer can't change between reserve and commit, only thread context ever swaps it
+    tx_len[tx_fill] = tx_len[tx_fill] + len;
+}
+
+bool usb_bulk_write(const void* data, int len) {
+    uint8_t* space = usb_bulk_tx_reserve(len);
+    if (!space) return false;
+    memcpy(space, data, len);
+    usb_bulk_tx_commit(len);
+    return true;
+}
+
+int usb_bulk_tx_room() {
+    return USB_BULK_BUF_SIZE - tx_len[tx_fill];
+}
+
+void usb_bulk_flush() {
+    uint32_t irq_state = save_and_disable_interrupts();
+    tx_submit();
+    restore_interrupts(irq_state);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// vendor-class bulk interface next to the CDC console (descriptors in usb_descriptors.c). it's a TinyUSB class driver
+// of our own rather than the stock vendor class, so transfers land in and go out of our buffers directly, with no
+// FIFO copy in between. each direction has two buffers: one is owned by the hardware while the other is filled
+// (IN) or processed (OUT), so the bus never waits on the firmware, and the firmware never blocks on the bus
+static constexpr int USB_BULK_BUF_SIZE = 4096;
+
+extern volatile uint32_t usb_bulk_rx_bytes;
+extern volatile uint32_t usb_bulk_tx_bytes;
+extern volatile uint32_t usb_bulk_tx_dropped; // records that found both IN buffers busy
+
+// the host has configured the interface
+bool usb_bulk_mounted();
+
+// oldest received buffer, returns its length or 0 when there's nothing. it stays ours until usb_bulk_rx_release(),
+// after which it goes back to the hardware
+int usb_bulk_rx_acquire(const uint8_t** data);
+void usb_bulk_rx_release();
+
+// room for a len byte record straight in the IN buffer, or nullptr if both are busy (counted as dropped).
+// usb_bulk_tx_commit() with what was written. records don't straddle transfers
+uint8_t* usb_bulk_tx_reserve(int len);
+void usb_bulk_tx_commit(int len);
+bool usb_bulk_write(const void* data, int len);
+// bytes a record can still take in the buffer being written
+int usb_bulk_tx_room();
+// starts the IN transfer of whatever has been written, if the endpoint is free. run from the idle loop
+void usb_bulk_flush();
+
+// what goes over it. OUT is a stream of messages, each an 8 byte header and its payload, split across transfers
+// however the host likes:
+//
+//   uint16_t type, uint16_t reserved, uint32_t payload length
+enum usb_bulk_message : uint16_t {
+    BULK_MSG_PLAN_TABLE = 1, // a plan table, as -plan upload takes it
+    BULK_MSG_FREQ_LIST = 2,  // float64 Hz values, each planned into the plan table on the first selected device
+    BULK_MSG_SINK = 3,       // thrown away, for measuring OUT throughput
+    BULK_MSG_STREAMS = 4,    // uint32_t mask of the telemetry streams to run (usb_bulk_record bits)
+};
+
+// IN is a stream of records, each a 4 byte header and a payload padded to a multiple of 4:
+//
+//   uint8_t type, uint8_t device, uint16_t payload length
+enum usb_bulk_record : uint8_t {
+    BULK_REC_LOCK = 1,     // uint32_t time us, int32_t lock time us (-1 for none), float64 frequency Hz
+    BULK_REC_READBACK = 2, // uint32_t time us, uint16_t R0 to R70 as read back, 2 bytes padding
+    BULK_REC_STATUS = 3,   // uint16_t message type, uint16_t status (0 is OK), uint32_t value (e.g. plans loaded)
+    BULK_REC_SOURCE = 4,   // uint32_t sequence number and filler, for measuring IN throughput
+};
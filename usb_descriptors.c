@@ -0,0 +1,100 @@
+#include "tusb.h"
+#include "pico/unique_id.h"
+#include "string.h"
+
+// composite device: the CDC console stdio uses, plus a vendor bulk interface for uploads and telemetry (usb_bulk.cpp).
+// replaces the SDK's CDC-only descriptors, so it has a product ID of its own to keep host driver caches apart
+
+#define USBD_VID (0x2E8A) // Raspberry Pi
+#define USBD_PID (0x4C4D)
+
+enum {
+    ITF_NUM_CDC,
+    ITF_NUM_CDC_DATA,
+    ITF_NUM_BULK,
+    ITF_NUM_TOTAL
+};
+
+#define EP_CDC_NOTIF  0x81
+#define EP_CDC_OUT    0x02
+#define EP_CDC_IN     0x82
+#define EP_BULK_OUT   0x03
+#define EP_BULK_IN    0x83
+
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN + TUD_VENDOR_DESC_LEN)
+
+enum {
+    STRID_LANGID,
+    STRID_MANUFACTURER,
+    STRID_PRODUCT,
+    STRID_SERIAL,
+    STRID_CDC,
+    STRID_BULK,
+};
+
+static const tusb_desc_device_t device_descriptor = {
+    .bLength = sizeof(tusb_desc_device_t),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = 0x0200,
+    // interface association, for the two CDC interfaces
+    .bDeviceClass = TUSB_CLASS_MISC,
+    .bDeviceSubClass = MISC_SUBCLASS_COMMON,
+    .bDeviceProtocol = MISC_PROTOCOL_IAD,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = USBD_VID,
+    .idProduct = USBD_PID,
+    .bcdDevice = 0x0100,
+    .iManufacturer = STRID_MANUFACTURER,
+    .iProduct = STRID_PRODUCT,
+    .iSerialNumber = STRID_SERIAL,
+    .bNumConfigurations = 1,
+};
+
+static const uint8_t config_descriptor[] = {
+    TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0, 500),
+    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, STRID_CDC, EP_CDC_NOTIF, 8, EP_CDC_OUT, EP_CDC_IN, 64),
+    TUD_VENDOR_DESCRIPTOR(ITF_NUM_BULK, STRID_BULK, EP_BULK_OUT, EP_BULK_IN, 64),
+};
+
+static const char* const string_descriptors[] = {
+    [STRID_MANUFACTURER] = "thaumatichthys",
+    [STRID_PRODUCT] = "LMX2592 Test Board",
+    [STRID_SERIAL] = NULL, // the flash unique ID, filled in below
+    [STRID_CDC] = "LMX2592 Console",
+    [STRID_BULK] = "LMX2592 Bulk",
+};
+
+const uint8_t* tud_descriptor_device_cb(void) {
+    return (const uint8_t*) &device_descriptor;
+}
+
+const uint8_t* tud_descriptor_configuration_cb(uint8_t index) {
+    (void) index;
+    return config_descriptor;
+}
+
+const uint16_t* tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
+    (void) langid;
+    static uint16_t descriptor[33];
+    char serial[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+    const char* str;
+    int len;
+
+    if (index == STRID_LANGID) {
+        descriptor[1] = 0x0409; // English
+        len = 1;
+    }
+    else {
+        if (index >= sizeof(string_descriptors) / sizeof(string_descriptors[0])) return NULL;
+        str = string_descriptors[index];
+        if (index == STRID_SERIAL) {
+            pico_get_unique_board_id_string(serial, sizeof(serial));
+            str = serial;
+        }
+        len = strlen(str);
+        if (len > 32) len = 32;
+        for (int i = 0; i < len; i++) descriptor[1 + i] = str[i];
+    }
+    descriptor[0] = (uint16_t) ((TUSB_DESC_STRING << 8) | (2 * len + 2));
+    return descriptor;
+}